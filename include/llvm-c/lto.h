@@ -27,7 +27,7 @@
  * @{
  */
 
-#define LTO_API_VERSION 4
+#define LTO_API_VERSION 6
 
 typedef enum {
     LTO_SYMBOL_ALIGNMENT_MASK              = 0x0000001F, /* log2 of alignment */
@@ -236,6 +236,28 @@ extern void
 lto_codegen_set_cpu(lto_code_gen_t cg, const char *cpu);
 
 
+/**
+ * Sets a directory in which generated native object files are cached.  If the
+ * merged modules, the preserved symbols and the code generation options are
+ * the same as in an earlier link that used this directory, the object file
+ * produced by that link is reused instead of optimizing and generating code
+ * again.  Passing NULL or an empty string disables the cache.
+ */
+extern void
+lto_codegen_set_cache_dir(lto_code_gen_t cg, const char *dir);
+
+
+/**
+ * Sets the number of partitions lto_codegen_compile_to_files() splits the
+ * optimized merged modules into.  The partitions are generated in parallel
+ * and together define the same symbols as the single object file of
+ * lto_codegen_compile().  The default is one partition.  Modules with debug
+ * info or module level asm are always generated as one partition.
+ */
+extern void
+lto_codegen_set_num_partitions(lto_code_gen_t cg, unsigned num);
+
+
 /**
  * Sets the location of the assembler tool to run. If not set, libLTO
  * will use gcc to invoke the assembler.
@@ -285,6 +307,20 @@ extern bool
 lto_codegen_compile_to_file(lto_code_gen_t cg, const char** name);
 
 
+/**
+ * Generates code for all added modules into one native object file per
+ * partition, see lto_codegen_set_num_partitions().  The output only depends
+ * on the modules and options, not on how the partitions were scheduled.
+ * The names of the files are written to names and their number to num; the
+ * array is owned by the lto_code_gen_t and is valid until
+ * lto_codegen_dispose() or the next call of this function.  The cache
+ * directory is not used.  Returns true on error.
+ */
+extern bool
+lto_codegen_compile_to_files(lto_code_gen_t cg, const char ***names,
+                             unsigned *num);
+
+
 /**
  * Sets options to help debug codegen bugs.
  */
@@ -129,6 +129,12 @@ static inline unsigned HashString(StringRef Str, unsigned Result = 0) {
   return Result;
 }
 
+/// HashString64 - A 64-bit FNV-1a hash of Str, continuing from Result.  The
+/// value only depends on the input, so unlike the hashes of Hashing.h it can
+/// be used for keys that are stored on disk or shared between processes.
+uint64_t HashString64(StringRef Str,
+                      uint64_t Result = 14695981039346656037ULL);
+
 /// Returns the English suffix for an ordinal integer (-st, -nd, -rd, -th).
 static inline StringRef getOrdinalSuffix(unsigned Val) {
   // It is critically important that we do this perfectly for
@@ -19,9 +19,11 @@
 
 #include "llvm/ADT/ilist.h"
 #include "llvm/ADT/ilist_node.h"
+#include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Path.h"
 #include <map>
 #include <set>
+#include <vector>
 
 namespace llvm {
   class MemoryBuffer;
@@ -339,10 +341,12 @@ class Archive {
     /// offset in the symbol table to obtain the real file offset. Note that
     /// there is purposefully no interface provided by Archive to look up
     /// members by their offset. Use the findModulesDefiningSymbols and
-    /// findModuleDefiningSymbol methods instead.
+    /// findModuleDefiningSymbol methods instead. Symbol lookups do not need
+    /// this map, so for an archive that was read from disk it is only built
+    /// the first time this method is called.
     /// @returns the Archive's symbol table.
     /// @brief Get the archive's symbol table
-    const SymTabType& getSymbolTable() { return symTab; }
+    const SymTabType& getSymbolTable();
 
     /// This method returns the offset in the archive file to the first "real"
     /// file member. Archive files, on disk, have a signature and might have a
@@ -440,6 +444,10 @@ class Archive {
   /// @name Implementation
   /// @{
   protected:
+    /// Symbols of previously loaded members, keyed by their contents; used
+    /// by writeToDisk to avoid parsing members that are written unchanged.
+    struct SymbolCache;
+
     /// @brief Construct an Archive for \p filename and optionally  map it
     /// into memory.
     explicit Archive(const sys::Path& filename, LLVMContext& C);
@@ -451,6 +459,14 @@ class Archive {
     /// @brief Parse the symbol table at \p data.
     bool parseSymbolTable(const void* data,unsigned len,std::string* error);
 
+    /// @returns true if \p symbol is in the symbol table, in which case
+    /// \p offset is set to the offset of the member that defines it.
+    /// @brief Look up a symbol in the symbol table.
+    bool lookupSymbol(StringRef symbol, unsigned& offset);
+
+    /// @brief Forget the symbol table and its index.
+    void clearSymbolTable();
+
     /// @returns A fully populated ArchiveMember or 0 if an error occurred.
     /// @brief Parse the header of a member starting at \p At
     ArchiveMember* parseMemberHeader(
@@ -487,9 +503,22 @@ class Archive {
       std::ofstream& ARFile,       ///< The file to write member onto
       bool CreateSymbolTable,      ///< Should symbol table be created?
       bool TruncateNames,          ///< Should names be truncated to 11 chars?
-      std::string* ErrMessage      ///< If non-null, place were error msg is set
+      std::string* ErrMessage,     ///< If non-null, place were error msg is set
+      SymbolCache* Cache = 0       ///< Symbols of the members loaded before
     );
 
+    /// @brief Collect the symbols the loaded symbol table lists per member.
+    void buildSymbolCache(SymbolCache& Cache);
+
+    /// Adds the symbols that the members whose symbols were taken from
+    /// \p Cache define, but that were listed under a member that is no longer
+    /// written or has changed. Returns true on error.
+    /// @brief Find the symbols that reusing cached symbols missed.
+    bool addLostSymbols(SymbolCache& Cache, std::string* ErrMessage);
+
+    /// @brief Add a symbol defined by the member at \p filepos.
+    void addSymbol(const std::string& symbol, unsigned filepos);
+
     /// @brief Fill in an ArchiveMemberHeader from ArchiveMember.
     bool fillHeader(const ArchiveMember&mbr,
                     ArchiveMemberHeader& hdr,int sz, bool TruncateNames) const;
@@ -507,6 +536,15 @@ class Archive {
     typedef std::map<unsigned,std::pair<Module*,ArchiveMember*> >
       ModuleMap;
 
+    /// This type records where loadArchive found a member, so that the writer
+    /// can tell which symbols the loaded symbol table lists for it.
+    /// @brief Loaded member location type
+    struct LoadedMember {
+      const char* data;  ///< The member's contents in the mapped file
+      unsigned size;     ///< The size of the contents
+      unsigned offset;   ///< The member's offset in the symbol table
+    };
+
 
   /// @}
   /// @name Data
@@ -517,10 +555,13 @@ class Archive {
     MemoryBuffer *mapfile;    ///< Raw Archive contents mapped into memory
     const char* base;         ///< Base of the memory mapped file data
     SymTabType symTab;        ///< The symbol table
+    const char* symTabData;   ///< The symbol table as read from the file
+    std::vector<unsigned> symTabIndex; ///< Hash table over symTabData entries
     std::string strtab;       ///< The string table for long file names
     unsigned symTabSize;      ///< Size in bytes of symbol table
     unsigned firstFileOffset; ///< Offset to first normal file.
     ModuleMap modules;        ///< The modules loaded via symbol lookup.
+    std::vector<LoadedMember> loadedMembers; ///< Members found by loadArchive
     ArchiveMember* foreignST; ///< This holds the foreign symbol table.
     LLVMContext& Context;     ///< This holds global data.
   /// @}
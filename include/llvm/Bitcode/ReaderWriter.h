@@ -29,10 +29,14 @@ namespace llvm {
   /// and prepare for lazy deserialization of function bodies.  If successful,
   /// this takes ownership of 'buffer' and returns a non-null pointer.  On
   /// error, this returns null, *does not* take ownership of Buffer, and fills
-  /// in *ErrMsg with an error description if ErrMsg is non-null.
+  /// in *ErrMsg with an error description if ErrMsg is non-null.  If
+  /// LazyMetadata is true, the module-level metadata is not read either until
+  /// a function body or the metadata itself (Module::MaterializeMetadata) is
+  /// materialized.
   Module *getLazyBitcodeModule(MemoryBuffer *Buffer,
                                LLVMContext &Context,
-                               std::string *ErrMsg = 0);
+                               std::string *ErrMsg = 0,
+                               bool LazyMetadata = false);
 
   /// getStreamedBitcodeModule - Read the header of the specified stream
   /// and prepare for lazy deserialization and streaming of function bodies.
@@ -33,7 +33,10 @@ public:
   explicit MachineFunctionAnalysis(const TargetMachine &tm);
   ~MachineFunctionAnalysis();
 
-  MachineFunction &getMF() const { return *MF; }
+  MachineFunction &getMF() const {
+    assert(MF && "No MachineFunction for this function!");
+    return *MF;
+  }
   
   virtual const char* getPassName() const {
     return "Machine Function Analysis";
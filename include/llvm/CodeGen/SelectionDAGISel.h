@@ -256,6 +256,15 @@ private:
                         BasicBlock::const_iterator End,
                         bool &HadTailCall);
   void CodeGenAndEmitDAG();
+
+  /// DAGNodesInFunction - The number of nodes in the DAGs built so far for
+  /// the current function, checked against the isel node budget.
+  unsigned DAGNodesInFunction;
+
+  /// isOverNodeBudget - Return true if the DAGs of the current function have
+  /// grown past the node budget, so that compile time should be favored over
+  /// code quality for the rest of it.
+  bool isOverNodeBudget() const;
   void LowerArguments(const BasicBlock *BB);
 
   void ComputeLiveOutVRegInfo();
@@ -345,6 +345,10 @@ private:
   /// debugLoc - source line information.
   DebugLoc debugLoc;
 
+  /// CombinerWorklistIndex - One plus the position of this node in the
+  /// DAGCombiner worklist, or zero if it is not on it.
+  unsigned CombinerWorklistIndex;
+
   /// getValueTypeList - Return a pointer to the specified value type.
   static const EVT *getValueTypeList(EVT VT);
 
@@ -413,6 +417,11 @@ public:
   /// setNodeId - Set unique node id.
   void setNodeId(int Id) { NodeId = Id; }
 
+  /// getCombinerWorklistIndex/setCombinerWorklistIndex - Used by the
+  /// DAGCombiner to find a node in its worklist without a separate set.
+  unsigned getCombinerWorklistIndex() const { return CombinerWorklistIndex; }
+  void setCombinerWorklistIndex(unsigned Idx) { CombinerWorklistIndex = Idx; }
+
   /// getDebugLoc - Return the source location info.
   const DebugLoc getDebugLoc() const { return debugLoc; }
 
@@ -683,7 +692,7 @@ protected:
       OperandList(NumOps ? new SDUse[NumOps] : 0),
       ValueList(VTs.VTs), UseList(NULL),
       NumOperands(NumOps), NumValues(VTs.NumVTs),
-      debugLoc(dl) {
+      debugLoc(dl), CombinerWorklistIndex(0) {
     for (unsigned i = 0; i != NumOps; ++i) {
       OperandList[i].setUser(this);
       OperandList[i].setInitial(Ops[i]);
@@ -697,7 +706,7 @@ protected:
     : NodeType(Opc), OperandsNeedDelete(false), HasDebugValue(false),
       SubclassData(0), NodeId(-1), OperandList(0), ValueList(VTs.VTs),
       UseList(NULL), NumOperands(0), NumValues(VTs.NumVTs),
-      debugLoc(dl) {}
+      debugLoc(dl), CombinerWorklistIndex(0) {}
 
   /// InitOperands - Initialize the operands list of this with 1 operand.
   void InitOperands(SDUse *Ops, const SDValue &Op0) {
@@ -341,6 +341,25 @@ namespace llvm {
     /// Renumber locally after inserting curItr.
     void renumberIndexes(IndexList::iterator curItr);
 
+    /// Grow the renumbering window (startItr, endItr) holding numEntries
+    /// entries until it can be spaced out evenly, and return the spacing.
+    unsigned spreadWindow(IndexList::iterator &startItr,
+                          IndexList::iterator &endItr, unsigned &numEntries);
+
+    /// Give the newly inserted entry at curItr an index between its
+    /// neighbours, renumbering locally if there is no room.
+    void numberInsertedEntry(IndexList::iterator curItr) {
+      assert(curItr != indexList.begin() && "Cannot number the first entry");
+      unsigned prevIndex = prior(curItr)->getIndex();
+      IndexList::iterator nextItr = llvm::next(curItr);
+      unsigned nextIndex = nextItr == indexList.end() ?
+        prevIndex + 2 * SlotIndex::InstrDist : nextItr->getIndex();
+      unsigned dist = ((nextIndex - prevIndex)/2) & ~3u;
+      curItr->setIndex(prevIndex + dist);
+      if (dist == 0)
+        renumberIndexes(curItr);
+    }
+
   public:
     static char ID;
 
@@ -550,18 +569,10 @@ namespace llvm {
         nextItr = llvm::next(prevItr);
       }
 
-      // Get a number for the new instr, or 0 if there's no room currently.
-      // In the latter case we'll force a renumber later.
-      unsigned dist = ((nextItr->getIndex() - prevItr->getIndex())/2) & ~3u;
-      unsigned newNumber = prevItr->getIndex() + dist;
-
-      // Insert a new list entry for mi.
+      // Insert a new list entry for mi and give it a number.
       IndexList::iterator newItr =
-        indexList.insert(nextItr, createEntry(mi, newNumber));
-
-      // Renumber locally if we need to.
-      if (dist == 0)
-        renumberIndexes(newItr);
+        indexList.insert(nextItr, createEntry(mi, 0));
+      numberInsertedEntry(newItr);
 
       SlotIndex newIndex(&*newItr, SlotIndex::Slot_Block);
       mi2iMap.insert(std::make_pair(mi, newIndex));
@@ -611,11 +622,21 @@ namespace llvm {
         nextEntry = getMBBStartIdx(nextMBB).listEntry();
       }
 
-      indexList.insert(nextEntry, startEntry);
-      indexList.insert(nextEntry, stopEntry);
-
+      // Number the new entries like inserted instructions, renumbering
+      // locally when there is no room between the neighbouring indexes.
+      // Insert and number the stop entry first, so that each entry is
+      // numbered between two entries that already have their indexes.
+      IndexList::iterator stopItr = indexList.insert(nextEntry, stopEntry);
+      numberInsertedEntry(stopItr);
+      IndexList::iterator startItr = indexList.insert(stopItr, startEntry);
+      numberInsertedEntry(startItr);
+
+      // A block appended to the function ends at its own stop entry;
+      // nextEntry is then the list sentinel, which has no index.
       SlotIndex startIdx(startEntry, SlotIndex::Slot_Block);
-      SlotIndex endIdx(nextEntry, SlotIndex::Slot_Block);
+      SlotIndex endIdx(nextMBB == mbb->getParent()->end() ? stopEntry
+                                                           : nextEntry,
+                       SlotIndex::Slot_Block);
 
       assert(unsigned(mbb->getNumber()) == MBBRanges.size() &&
              "Blocks must be added in order");
@@ -623,7 +644,6 @@ namespace llvm {
 
       idx2MBBMap.push_back(IdxMBBPair(startIdx, mbb));
 
-      renumberIndexes();
       std::sort(idx2MBBMap.begin(), idx2MBBMap.end(), Idx2MBBCompare());
     }
 
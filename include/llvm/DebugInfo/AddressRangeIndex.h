@@ -0,0 +1,96 @@
+//===-- AddressRangeIndex.h -------------------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines AddressRangeIndex, which finds the innermost of a set of
+// possibly nested address ranges that contains an address.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_DEBUGINFO_ADDRESSRANGEINDEX_H
+#define LLVM_DEBUGINFO_ADDRESSRANGEINDEX_H
+
+#include "llvm/Support/DataTypes.h"
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace llvm {
+
+/// AddressRangeIndex - A set of address ranges, each with a value, such as
+/// the functions of an object file or the subprograms of a compile unit.
+/// Ranges may overlap. Add all of them, call finalize() and look addresses up
+/// with find(), which costs a binary search unless ranges are nested.
+template <typename ValueT>
+class AddressRangeIndex {
+  struct Entry {
+    uint64_t LowPC;
+    uint64_t HighPC;    // Last address in the range.
+    uint64_t MaxHighPC; // Largest HighPC of this and all earlier entries.
+    ValueT Value;
+    bool operator<(const Entry &RHS) const { return LowPC < RHS.LowPC; }
+  };
+  std::vector<Entry> Entries;
+  bool Finalized;
+
+public:
+  AddressRangeIndex() : Finalized(true) {}
+
+  void clear() {
+    Entries.clear();
+    Finalized = true;
+  }
+
+  /// insert - Adds the range [LowPC, HighPC], inclusive at both ends.
+  void insert(uint64_t LowPC, uint64_t HighPC, const ValueT &Value) {
+    Entry E;
+    E.LowPC = LowPC;
+    E.HighPC = HighPC;
+    E.MaxHighPC = HighPC;
+    E.Value = Value;
+    Entries.push_back(E);
+    Finalized = false;
+  }
+
+  /// finalize - Sorts the ranges for lookups. Ranges that start at the same
+  /// address keep the order they were inserted in.
+  void finalize() {
+    std::stable_sort(Entries.begin(), Entries.end());
+    for (size_t i = 1, e = Entries.size(); i < e; ++i)
+      Entries[i].MaxHighPC = std::max(Entries[i].HighPC,
+                                      Entries[i - 1].MaxHighPC);
+    Finalized = true;
+  }
+
+  /// find - Returns the value of the range containing Address that starts
+  /// closest to it, so the innermost one if ranges are nested, or null if no
+  /// range contains Address. Of several such ranges starting at the same
+  /// address, the one inserted first wins.
+  const ValueT *find(uint64_t Address) const {
+    assert(Finalized && "AddressRangeIndex looked up before finalize()!");
+    Entry Key;
+    Key.LowPC = Address;
+    typename std::vector<Entry>::const_iterator B = Entries.begin(),
+      I = std::upper_bound(B, Entries.end(), Key);
+    // Walk back from the last range starting at or below Address until no
+    // earlier range reaches it.
+    const Entry *Found = 0;
+    while (I != B && (I - 1)->MaxHighPC >= Address) {
+      --I;
+      if (Found && I->LowPC != Found->LowPC)
+        break;
+      if (Address <= I->HighPC)
+        Found = &*I;
+    }
+    return Found ? &Found->Value : 0;
+  }
+};
+
+}  // namespace llvm
+
+#endif  // LLVM_DEBUGINFO_ADDRESSRANGEINDEX_H
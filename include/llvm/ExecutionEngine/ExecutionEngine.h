@@ -42,6 +42,7 @@ class JITMemoryManager;
 class MachineCodeInfo;
 class Module;
 class MutexGuard;
+class ObjectCache;
 class DataLayout;
 class Triple;
 class Type;
@@ -109,9 +110,16 @@ class ExecutionEngine {
   /// Whether lazy JIT compilation is enabled.
   bool CompilingLazily;
 
+  /// Whether MCJIT compiles lazily in per-function units.
+  bool UnitCompilationEnabled;
+
   /// Whether JIT compilation of external global variables is allowed.
   bool GVCompilationDisabled;
 
+  /// The number of calls after which the JIT recompiles a function with the
+  /// full code generator, or 0 if tiered compilation is disabled.
+  unsigned TierUpThreshold;
+
   /// Whether the JIT should perform lookups of external symbols (e.g.,
   /// using dlsym).
   bool SymbolSearchingDisabled;
@@ -371,6 +379,12 @@ public:
   virtual void RegisterJITEventListener(JITEventListener *) {}
   virtual void UnregisterJITEventListener(JITEventListener *) {}
 
+  /// Sets the pre-compiled object cache.  The ownership of the ObjectCache is
+  /// not changed.  Supported by MCJIT but not JIT.
+  virtual void setObjectCache(ObjectCache *) {
+    llvm_unreachable("No support for an object cache");
+  }
+
   /// DisableLazyCompilation - When lazy compilation is off (the default), the
   /// JIT will eagerly compile every function reachable from the argument to
   /// getPointerToFunction.  If lazy compilation is turned on, the JIT will only
@@ -396,6 +410,31 @@ public:
     return !CompilingLazily;
   }
 
+  /// EnableUnitCompilation - If lazy compilation is also on, MCJIT compiles
+  /// the module in units instead of as a whole: each call to
+  /// getPointerToFunction compiles the requested function together with
+  /// every function reachable from it that has not been compiled yet.  This
+  /// must be set before the first function is compiled.  Only supported by
+  /// MCJIT; modules with aliases or debug info are still compiled as a whole.
+  void EnableUnitCompilation(bool Enabled = true) {
+    UnitCompilationEnabled = Enabled;
+  }
+  bool isUnitCompilationEnabled() const {
+    return UnitCompilationEnabled;
+  }
+
+  /// setTierUpThreshold - When non-zero, the JIT first compiles functions with
+  /// the fast instruction selector and counts their calls.  Once a function
+  /// has been called Calls times it is recompiled with the full code generator
+  /// and its old entry point is patched to branch to the new code, as with
+  /// recompileAndRelinkFunction.  Only supported by the JIT.
+  void setTierUpThreshold(unsigned Calls) {
+    TierUpThreshold = Calls;
+  }
+  unsigned getTierUpThreshold() const {
+    return TierUpThreshold;
+  }
+
   /// DisableGVCompilation - If called, the JIT will abort if it's asked to
   /// allocate space and populate a GlobalVariable that is not internal to
   /// the module.
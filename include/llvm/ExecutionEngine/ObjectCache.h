@@ -0,0 +1,88 @@
+//===-- ObjectCache.h - Class definition for the ObjectCache -----C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the ObjectCache interface, which lets clients of MCJIT
+// reuse object files generated for a module instead of running code
+// generation again, and FileObjectCache, an implementation of it that keeps
+// the objects in a directory on disk.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_OBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_OBJECTCACHE_H
+
+#include "llvm/ADT/StringRef.h"
+#include <string>
+
+namespace llvm {
+
+class MemoryBuffer;
+class Module;
+class TargetMachine;
+
+/// ObjectCache - This is the base class for an object cache that can be set on
+/// an MCJIT instance with ExecutionEngine::setObjectCache.  Before generating
+/// code for a module, MCJIT asks the cache for an object; on a miss it
+/// generates the object itself and hands it to the cache.
+class ObjectCache {
+  virtual void anchor();
+public:
+  ObjectCache() { }
+
+  virtual ~ObjectCache() { }
+
+  /// notifyObjectCompiled - Provides a pointer to compiled code for Module M.
+  /// The cache must copy the data it wants to keep; Obj is only valid for the
+  /// duration of the call.
+  virtual void notifyObjectCompiled(const Module *M,
+                                    const MemoryBuffer *Obj) = 0;
+
+  /// getObject - Returns a newly allocated MemoryBuffer that contains the
+  /// object which corresponds with Module M, or 0 if an object is not
+  /// available.  The caller owns the returned buffer and may modify its
+  /// contents while loading it.
+  virtual MemoryBuffer *getObject(const Module *M) = 0;
+};
+
+/// FileObjectCache - An ObjectCache that stores one object file per module in
+/// a directory.  Objects are keyed by a hash of the module's bitcode together
+/// with the code generation configuration of the TargetMachine the cache was
+/// created for (triple, CPU, features, optimization level, relocation and code
+/// model), so the same directory can be shared between differently configured
+/// JITs.  Files are written to a temporary name and renamed into place, so a
+/// concurrent reader never observes a partially written object.
+///
+/// Computing the key serializes the whole module to bitcode, which costs
+/// roughly as much as writing a .bc file.  It is done once per module: the
+/// path found by a missed getObject is reused when the object is handed back,
+/// which also keeps the key independent of IR changes made by code generation.
+class FileObjectCache : public ObjectCache {
+  std::string CacheDir;
+  std::string Configuration;
+
+  /// LastModule/LastPath - The module of the last getObject call and the path
+  /// computed for it.
+  const Module *LastModule;
+  std::string LastPath;
+
+public:
+  /// Create a cache in the directory CacheDir for code generated by TM.  The
+  /// directory is created on first use if it does not exist.
+  FileObjectCache(StringRef CacheDir, const TargetMachine &TM);
+
+  virtual void notifyObjectCompiled(const Module *M, const MemoryBuffer *Obj);
+  virtual MemoryBuffer *getObject(const Module *M);
+
+  /// getCacheFilePath - Return the path of the file holding the object for M.
+  std::string getCacheFilePath(const Module *M) const;
+};
+
+} // End llvm namespace
+
+#endif
@@ -59,6 +59,13 @@ public:
   /// information about the problem.  If successful, this returns false.
   ///
   virtual bool MaterializeModule(Module *M, std::string *ErrInfo = 0) = 0;
+
+  /// MaterializeMetadata - make sure the module-level metadata has been read.
+  /// Materializers that read metadata up front don't need to override this.
+  /// On error, this returns true and fills in the optional string with
+  /// information about the problem.  If successful, this returns false.
+  ///
+  virtual bool MaterializeMetadata(std::string *ErrInfo = 0) { return false; }
 };
 
 } // End llvm namespace
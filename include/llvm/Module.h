@@ -467,6 +467,11 @@ public:
   /// problem, and DOES NOT clear the old Materializer.  If successful, this
   /// returns false.
   bool MaterializeAllPermanently(std::string *ErrInfo = 0);
+  /// MaterializeMetadata - Make sure the named metadata and metadata kinds of
+  /// this Module are read, without reading any function bodies.  If the module
+  /// is corrupt, this returns true and fills in the optional string with
+  /// information about the problem.  If successful, this returns false.
+  bool MaterializeMetadata(std::string *ErrInfo = 0);
 
 /// @}
 /// @name Direct access to the globals list, functions list, and symbol table
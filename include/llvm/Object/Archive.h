@@ -27,6 +27,7 @@ public:
   class Child {
     const Archive *Parent;
     StringRef Data;
+    friend class Archive;
 
   public:
     Child(const Archive *p, StringRef d) : Parent(p), Data(d) {}
@@ -48,6 +49,8 @@ public:
     ///! Return the size of the archive member without the header or padding.
     uint64_t getSize() const;
 
+    /// Return the contents of the member.  The members of a thin archive are
+    /// only read, from the file they refer to, when this is called.
     MemoryBuffer *getBuffer() const;
     error_code getAsBinary(OwningPtr<Binary> &Result) const;
   };
@@ -128,6 +131,10 @@ public:
   symbol_iterator begin_symbols() const;
   symbol_iterator end_symbols() const;
 
+  /// Return true if this is a thin archive, whose members are stored in
+  /// separate files and only referenced by path.
+  bool isThin() const { return IsThin; }
+
   // Cast methods.
   static inline bool classof(Binary const *v) {
     return v->isArchive();
@@ -136,6 +143,7 @@ public:
 private:
   child_iterator SymbolTable;
   child_iterator StringTable;
+  bool IsThin;
 };
 
 }
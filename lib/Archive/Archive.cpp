@@ -143,8 +143,9 @@ bool ArchiveMember::replaceWith(const sys::Path& newFile, std::string* ErrMsg) {
 // Archive class. Everything else (default,copy) is deprecated. This just
 // initializes and maps the file into memory, if requested.
 Archive::Archive(const sys::Path& filename, LLVMContext& C)
-  : archPath(filename), members(), mapfile(0), base(0), symTab(), strtab(),
-    symTabSize(0), firstFileOffset(0), modules(), foreignST(0), Context(C) {
+  : archPath(filename), members(), mapfile(0), base(0), symTab(),
+    symTabData(0), strtab(), symTabSize(0), firstFileOffset(0), modules(),
+    foreignST(0), Context(C) {
 }
 
 bool
@@ -167,8 +168,8 @@ void Archive::cleanUpMemory() {
   base = 0;
 
   // Forget the entire symbol table
-  symTab.clear();
-  symTabSize = 0;
+  clearSymbolTable();
+  loadedMembers.clear();
 
   firstFileOffset = 0;
 
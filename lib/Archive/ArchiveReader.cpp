@@ -13,6 +13,7 @@
 
 #include "ArchiveInternals.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Module.h"
@@ -35,13 +36,26 @@ static inline unsigned readInteger(const char*&At, const char*End) {
   return Result;
 }
 
-// Completely parse the Archive's symbol table and populate symTab member var.
+/// Decode the symbol table entry at At, returning the symbol name and setting
+/// offset to the offset of the member that defines it.
+static inline StringRef readSymbolEntry(const char* At, const char* End,
+                                        unsigned& offset) {
+  offset = readInteger(At, End);
+  unsigned length = readInteger(At, End);
+  return StringRef(At, length);
+}
+
+// Check the Archive's symbol table and index it for lookups by name.  The
+// index refers to the entries in place, so no symbol names are copied.
 bool
 Archive::parseSymbolTable(const void* data, unsigned size, std::string* error) {
-  const char* At = (const char*) data;
+  const char* Begin = (const char*) data;
+  const char* At = Begin;
   const char* End = At + size;
+  std::vector<unsigned> Entries;
   while (At < End) {
-    unsigned offset = readInteger(At, End);
+    const char* Entry = At;
+    readInteger(At, End);
     if (At == End) {
       if (error)
         *error = "Ran out of data reading vbr_uint for symtab offset!";
@@ -58,14 +72,82 @@ Archive::parseSymbolTable(const void* data, unsigned size, std::string* error) {
         *error = "Malformed symbol table: length not consistent with size";
       return false;
     }
-    // we don't care if it can't be inserted (duplicate entry)
-    symTab.insert(std::make_pair(std::string(At, length), offset));
+    Entries.push_back(Entry - Begin);
     At += length;
   }
+
   symTabSize = size;
+  if (Entries.empty())
+    return true;
+
+  // Build an open addressing hash table of the entries, at most half full.
+  // Buckets hold the entry's position in the table plus one, zero is empty.
+  symTabData = Begin;
+  symTabIndex.assign(NextPowerOf2(Entries.size() * 2), 0);
+  unsigned Mask = symTabIndex.size() - 1;
+  for (unsigned i = 0, e = Entries.size(); i != e; ++i) {
+    unsigned offset;
+    StringRef Name = readSymbolEntry(Begin + Entries[i], End, offset);
+    for (unsigned Bucket = HashString(Name) & Mask;;
+         Bucket = (Bucket + 1) & Mask) {
+      unsigned &Slot = symTabIndex[Bucket];
+      if (Slot == 0) {
+        Slot = Entries[i] + 1;
+        break;
+      }
+      // we don't care if it can't be inserted (duplicate entry)
+      if (readSymbolEntry(Begin + Slot - 1, End, offset) == Name)
+        break;
+    }
+  }
   return true;
 }
 
+// Look up a symbol in the index of the symbol table read from the file or, if
+// there is none, in the symbol table built from the members.
+bool Archive::lookupSymbol(StringRef symbol, unsigned& offset) {
+  if (symTabIndex.empty()) {
+    SymTabType::iterator SI = symTab.find(symbol);
+    if (SI == symTab.end())
+      return false;
+    offset = SI->second;
+    return true;
+  }
+
+  const char* End = symTabData + symTabSize;
+  unsigned Mask = symTabIndex.size() - 1;
+  for (unsigned Bucket = HashString(symbol) & Mask;;
+       Bucket = (Bucket + 1) & Mask) {
+    unsigned Slot = symTabIndex[Bucket];
+    if (Slot == 0)
+      return false;
+    if (readSymbolEntry(symTabData + Slot - 1, End, offset) == symbol)
+      return true;
+  }
+}
+
+const Archive::SymTabType& Archive::getSymbolTable() {
+  // Decode the table read from the file if that has not been done yet.
+  if (symTab.empty() && symTabData) {
+    const char* At = symTabData;
+    const char* End = symTabData + symTabSize;
+    while (At < End) {
+      unsigned offset = readInteger(At, End);
+      unsigned length = readInteger(At, End);
+      symTab.insert(std::make_pair(std::string(At, length), offset));
+      At += length;
+    }
+  }
+  return symTab;
+}
+
+void Archive::clearSymbolTable() {
+  symTab.clear();
+  symTabData = 0;
+  symTabIndex.clear();
+  symTabSize = 0;
+}
+
 // This member parses an ArchiveMemberHeader that is presumed to be pointed to
 // by At. The At pointer is updated to the byte just after the header, which
 // can be variable in size.
@@ -251,7 +333,8 @@ Archive::loadArchive(std::string* error) {
 
   // Set up parsing
   members.clear();
-  symTab.clear();
+  loadedMembers.clear();
+  clearSymbolTable();
   const char *At = base;
   const char *End = mapfile->getBufferEnd();
 
@@ -314,6 +397,9 @@ Archive::loadArchive(std::string* error) {
         firstFileOffset = Save - base;
         foundFirstFile = true;
       }
+      LoadedMember Loaded = { mbr->getData(), unsigned(mbr->getSize()),
+                              unsigned(Save - base) - firstFileOffset };
+      loadedMembers.push_back(Loaded);
       members.push_back(mbr);
       At += mbr->getSize();
       if ((intptr_t(At) & 1) == 1)
@@ -365,7 +451,7 @@ Archive::loadSymbolTable(std::string* ErrorMsg) {
 
   // Set up parsing
   members.clear();
-  symTab.clear();
+  clearSymbolTable();
   const char *At = base;
   const char *End = mapfile->getBufferEnd();
 
@@ -455,8 +541,8 @@ Archive* Archive::OpenAndLoadSymbols(const sys::Path& file,
 Module*
 Archive::findModuleDefiningSymbol(const std::string& symbol, 
                                   std::string* ErrMsg) {
-  SymTabType::iterator SI = symTab.find(symbol);
-  if (SI == symTab.end())
+  unsigned symbolOffset;
+  if (!lookupSymbol(symbol, symbolOffset))
     return 0;
 
   // The symbol table was previously constructed assuming that the members were
@@ -466,7 +552,7 @@ Archive::findModuleDefiningSymbol(const std::string& symbol,
   // We now have to account for this by adjusting the offset by the size of the
   // symbol table and its header.
   unsigned fileOffset =
-    SI->second +                // offset in symbol-table-less file
+    symbolOffset +              // offset in symbol-table-less file
     firstFileOffset;            // add offset to first "real" file in archive
 
   // See if the module is already loaded
@@ -509,7 +595,7 @@ Archive::findModulesDefiningSymbols(std::set<std::string>& symbols,
     return false;
   }
 
-  if (symTab.empty()) {
+  if (symTab.empty() && symTabIndex.empty()) {
     // We don't have a symbol table, so we must build it now but lets also
     // make sure that we populate the modules table as we do this to ensure
     // that we don't load them twice when findModuleDefiningSymbol is called
@@ -593,13 +679,13 @@ Archive::findModulesDefiningSymbols(std::set<std::string>& symbols,
 bool Archive::isBitcodeArchive() {
   // Make sure the symTab has been loaded. In most cases this should have been
   // done when the archive was constructed, but still,  this is just in case.
-  if (symTab.empty())
+  if (symTab.empty() && symTabIndex.empty())
     if (!loadSymbolTable(0))
       return false;
 
   // Now that we know it's been loaded, return true
   // if it has a size
-  if (symTab.size()) return true;
+  if (symTab.size() || symTabSize) return true;
 
   // We still can't be sure it isn't a bitcode archive
   if (!loadArchive(0))
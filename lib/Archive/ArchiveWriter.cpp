@@ -13,6 +13,7 @@
 
 #include "ArchiveInternals.h"
 #include "llvm/Module.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/Support/FileSystem.h"
@@ -20,6 +21,7 @@
 #include "llvm/Support/Process.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/system_error.h"
+#include <cstring>
 #include <fstream>
 #include <ostream>
 #include <iomanip>
@@ -65,6 +67,56 @@ static inline unsigned numVbrBytes(unsigned num) {
   return 5; // anything >= 2^28 takes 5 bytes
 }
 
+// The symbols the loaded symbol table lists for each loaded member, keyed by a
+// hash and the size of the member's contents. A member that is written again
+// with the same contents, whether it was kept or replaced by an identical file,
+// gets its symbols from here instead of having its bitcode parsed. The key only
+// finds the candidate entry; the contents are compared with the loaded
+// member's, which stays mapped until the archive is written.
+//
+// The table only lists a symbol under the first member that defines it, so a
+// member's entry misses the symbols an earlier member also defines. That is
+// harmless while the earlier member is still written first, so entries are
+// only used while the reused members keep their relative order, and
+// addLostSymbols deals with the symbols whose listed member is gone.
+struct Archive::SymbolCache {
+  struct Entry {
+    unsigned Offset;                  // Offset of the member when loaded
+    const char* Data;                 // Contents of the loaded member
+    std::vector<std::string> Symbols; // Symbols listed for it
+  };
+  typedef std::map<std::pair<size_t, size_t>, Entry> EntryMap;
+
+  EntryMap Entries;
+  SymTabType OldSymTab;                // The loaded symbol table
+  std::set<unsigned> ReusedOffsets;    // Loaded offsets of reused members
+  // Members whose symbols were taken from here, with their new positions.
+  std::vector<std::pair<const ArchiveMember*, unsigned> > Reused;
+  unsigned NextOffset;                 // Lowest loaded offset still reusable
+  bool InOrder;                        // Have reused members kept their order?
+
+  SymbolCache() : NextOffset(0), InOrder(true) {}
+
+  static std::pair<size_t, size_t> getKey(const char* data, size_t size) {
+    return std::make_pair(size_t(hash_value(StringRef(data, size))), size);
+  }
+
+  const Entry* lookup(const char* data, size_t size) {
+    if (!InOrder)
+      return 0;
+    EntryMap::iterator I = Entries.find(getKey(data, size));
+    if (I == Entries.end() || memcmp(I->second.Data, data, size) != 0)
+      return 0;
+    if (I->second.Offset < NextOffset) {
+      InOrder = false;
+      return 0;
+    }
+    NextOffset = I->second.Offset + 1;
+    ReusedOffsets.insert(I->second.Offset);
+    return &I->second;
+  }
+};
+
 // Create an empty archive.
 Archive* Archive::CreateEmpty(const sys::Path& FilePath, LLVMContext& C) {
   Archive* result = new Archive(FilePath, C);
@@ -204,7 +256,8 @@ Archive::writeMember(
   std::ofstream& ARFile,
   bool CreateSymbolTable,
   bool TruncateNames,
-  std::string* ErrMsg
+  std::string* ErrMsg,
+  SymbolCache* Cache
 ) {
 
   unsigned filepos = ARFile.tellp();
@@ -229,7 +282,15 @@ Archive::writeMember(
 
   // Now that we have the data in memory, update the
   // symbol table if it's a bitcode file.
-  if (CreateSymbolTable && member.isBitcode()) {
+  const SymbolCache::Entry* Cached = 0;
+  if (CreateSymbolTable && member.isBitcode() && Cache)
+    Cached = Cache->lookup(data, fSize);
+  if (Cached) {
+    for (std::vector<std::string>::const_iterator SI = Cached->Symbols.begin(),
+         SE = Cached->Symbols.end(); SI != SE; ++SI)
+      addSymbol(*SI, filepos);
+    Cache->Reused.push_back(std::make_pair(&member, filepos));
+  } else if (CreateSymbolTable && member.isBitcode()) {
     std::vector<std::string> symbols;
     std::string FullMemberName = archPath.str() + "(" + member.getPath().str()
       + ")";
@@ -239,17 +300,8 @@ Archive::writeMember(
     // If the bitcode parsed successfully
     if ( M ) {
       for (std::vector<std::string>::iterator SI = symbols.begin(),
-           SE = symbols.end(); SI != SE; ++SI) {
-
-        std::pair<SymTabType::iterator,bool> Res =
-          symTab.insert(std::make_pair(*SI,filepos));
-
-        if (Res.second) {
-          symTabSize += SI->length() +
-                        numVbrBytes(SI->length()) +
-                        numVbrBytes(filepos);
-        }
-      }
+           SE = symbols.end(); SI != SE; ++SI)
+        addSymbol(*SI, filepos);
       // We don't need this module any more.
       delete M;
     } else {
@@ -288,6 +340,108 @@ Archive::writeMember(
   return false;
 }
 
+// Add a symbol defined by the member at filepos to the symbol table, unless an
+// earlier member already defines it.
+void Archive::addSymbol(const std::string& symbol, unsigned filepos) {
+  std::pair<SymTabType::iterator,bool> Res =
+    symTab.insert(std::make_pair(symbol,filepos));
+
+  if (Res.second) {
+    symTabSize += symbol.length() +
+                  numVbrBytes(symbol.length()) +
+                  numVbrBytes(filepos);
+  }
+}
+
+// Collect the symbols the loaded symbol table lists for each loaded member.
+void Archive::buildSymbolCache(SymbolCache& Cache) {
+  // Without a loaded symbol table there is nothing to reuse; in particular,
+  // an empty symbol list would not mean that a member defines no symbols.
+  if (loadedMembers.empty() || getSymbolTable().empty())
+    return;
+
+  std::map<unsigned, SymbolCache::Entry*> ByOffset;
+  for (unsigned i = 0, e = loadedMembers.size(); i != e; ++i) {
+    const LoadedMember& LM = loadedMembers[i];
+    std::pair<SymbolCache::EntryMap::iterator, bool> Res =
+      Cache.Entries.insert(std::make_pair(
+        SymbolCache::getKey(LM.data, LM.size), SymbolCache::Entry()));
+    // Members with the same contents share the first one's entry.
+    if (!Res.second)
+      continue;
+    Res.first->second.Offset = LM.offset;
+    Res.first->second.Data = LM.data;
+    ByOffset[LM.offset] = &Res.first->second;
+  }
+
+  Cache.OldSymTab.swap(symTab);
+  for (SymTabType::iterator I = Cache.OldSymTab.begin(),
+       E = Cache.OldSymTab.end(); I != E; ++I) {
+    std::map<unsigned, SymbolCache::Entry*>::iterator M =
+      ByOffset.find(I->second);
+    if (M != ByOffset.end())
+      M->second->Symbols.push_back(I->first);
+  }
+}
+
+// The symbols the loaded symbol table listed under a member that has not been
+// reused may also be defined by reused members, whose cache entries then lack
+// them. Parse the reused members in order until each such symbol is assigned
+// to the first member that defines it.
+bool Archive::addLostSymbols(SymbolCache& Cache, std::string* ErrMsg) {
+  std::set<std::string> Lost;
+  for (SymTabType::iterator I = Cache.OldSymTab.begin(),
+       E = Cache.OldSymTab.end(); I != E; ++I)
+    if (!Cache.ReusedOffsets.count(I->second))
+      Lost.insert(I->first);
+
+  for (unsigned i = 0, e = Cache.Reused.size(); i != e && !Lost.empty(); ++i) {
+    const ArchiveMember& member = *Cache.Reused[i].first;
+    unsigned filepos = Cache.Reused[i].second;
+
+    OwningPtr<MemoryBuffer> File;
+    const char* data = member.getData();
+    size_t size = member.getSize();
+    if (!data) {
+      if (error_code ec = MemoryBuffer::getFile(member.getPath().c_str(),
+                                                File)) {
+        if (ErrMsg)
+          *ErrMsg = ec.message();
+        return true;
+      }
+      data = File->getBufferStart();
+      size = File->getBufferSize();
+    }
+
+    std::vector<std::string> symbols;
+    std::string FullMemberName = archPath.str() + "(" + member.getPath().str()
+      + ")";
+    OwningPtr<Module> M(GetBitcodeSymbols(data, size, FullMemberName,
+                                          Context, symbols, ErrMsg));
+    if (!M) {
+      if (ErrMsg)
+        *ErrMsg = "Can't parse bitcode member: " + member.getPath().str()
+          + ": " + *ErrMsg;
+      return true;
+    }
+
+    for (std::vector<std::string>::iterator SI = symbols.begin(),
+         SE = symbols.end(); SI != SE; ++SI) {
+      if (!Lost.erase(*SI))
+        continue;
+      SymTabType::iterator Owner = symTab.find(*SI);
+      if (Owner == symTab.end()) {
+        addSymbol(*SI, filepos);
+      } else if (Owner->second > filepos) {
+        symTabSize -= numVbrBytes(Owner->second);
+        symTabSize += numVbrBytes(filepos);
+        Owner->second = filepos;
+      }
+    }
+  }
+  return false;
+}
+
 // Write out the LLVM symbol table as an archive member to the file.
 void
 Archive::writeSymbolTable(std::ofstream& ARFile) {
@@ -380,10 +534,12 @@ Archive::writeToDisk(bool CreateSymbolTable, bool TruncateNames,
     return true;
   }
 
-  // If we're creating a symbol table, reset it now
+  // If we're creating a symbol table, reset it now, keeping what the loaded
+  // one says about the members.
+  SymbolCache Cache;
   if (CreateSymbolTable) {
-    symTabSize = 0;
-    symTab.clear();
+    buildSymbolCache(Cache);
+    clearSymbolTable();
   }
 
   // Write magic string to archive.
@@ -393,13 +549,19 @@ Archive::writeToDisk(bool CreateSymbolTable, bool TruncateNames,
   // builds the symbol table, symTab.
   for (MembersList::iterator I = begin(), E = end(); I != E; ++I) {
     if (writeMember(*I, ArchiveFile, CreateSymbolTable,
-                     TruncateNames, ErrMsg)) {
+                     TruncateNames, ErrMsg, &Cache)) {
       TmpArchive.eraseFromDisk();
       ArchiveFile.close();
       return true;
     }
   }
 
+  if (CreateSymbolTable && addLostSymbols(Cache, ErrMsg)) {
+    TmpArchive.eraseFromDisk();
+    ArchiveFile.close();
+    return true;
+  }
+
   // Close archive file.
   ArchiveFile.close();
 
@@ -51,6 +51,7 @@ void BitcodeReader::FreeState() {
   std::vector<BasicBlock*>().swap(FunctionBBs);
   std::vector<Function*>().swap(FunctionsWithBodies);
   DeferredFunctionInfo.clear();
+  std::vector<uint64_t>().swap(DeferredMetadataInfo);
   MDKindMap.clear();
 
   assert(BlockAddrFwdRefs.empty() && "Unresolved blockaddress fwd references");
@@ -1482,6 +1483,14 @@ bool BitcodeReader::ParseModule(bool Resume) {
           return true;
         break;
       case bitc::METADATA_BLOCK_ID:
+        // Remember where the block is and read it when the metadata is
+        // materialized.
+        if (LazyMetadata && !LazyStreamer) {
+          DeferredMetadataInfo.push_back(Stream.GetCurrentBitNo());
+          if (Stream.SkipBlock())
+            return Error("Malformed block record");
+          break;
+        }
         if (ParseMetadata())
           return true;
         break;
@@ -2797,6 +2806,19 @@ bool BitcodeReader::Materialize(GlobalValue *GV, std::string *ErrInfo) {
   // If it's not a function or is already material, ignore the request.
   if (!F || !F->isMaterializable()) return false;
 
+  // Function bodies refer to the module-level metadata by number.
+  if (MaterializeMetadata(ErrInfo) || ParseDeferredFunctionBody(F, ErrInfo))
+    return true;
+
+  // Upgrade any old intrinsic calls in the function.
+  UpgradeIntrinsicCalls();
+  return false;
+}
+
+/// ParseDeferredFunctionBody - Read the body of the materializable function F
+/// from the position recorded for it in DeferredFunctionInfo.
+bool BitcodeReader::ParseDeferredFunctionBody(Function *F,
+                                              std::string *ErrInfo) {
   DenseMap<Function*, uint64_t>::iterator DFII = DeferredFunctionInfo.find(F);
   assert(DFII != DeferredFunctionInfo.end() && "Deferred function not found!");
   // If its position is recorded as 0, its body is somewhere in the stream
@@ -2811,8 +2833,12 @@ bool BitcodeReader::Materialize(GlobalValue *GV, std::string *ErrInfo) {
     if (ErrInfo) *ErrInfo = ErrorString;
     return true;
   }
+  return false;
+}
 
-  // Upgrade any old intrinsic calls in the function.
+/// UpgradeIntrinsicCalls - Rewrite the calls to old intrinsics in the bodies
+/// that have been read so far.
+void BitcodeReader::UpgradeIntrinsicCalls() {
   for (UpgradedIntrinsicMap::iterator I = UpgradedIntrinsics.begin(),
        E = UpgradedIntrinsics.end(); I != E; ++I) {
     if (I->first != I->second) {
@@ -2823,7 +2849,22 @@ bool BitcodeReader::Materialize(GlobalValue *GV, std::string *ErrInfo) {
       }
     }
   }
+}
 
+bool BitcodeReader::MaterializeMetadata(std::string *ErrInfo) {
+  if (DeferredMetadataInfo.empty())
+    return false;
+
+  // Everything that reads from the stream after this jumps to its own
+  // position first, so the cursor is not restored.
+  for (unsigned i = 0, e = DeferredMetadataInfo.size(); i != e; ++i) {
+    Stream.JumpToBit(DeferredMetadataInfo[i]);
+    if (ParseMetadata()) {
+      if (ErrInfo) *ErrInfo = ErrorString;
+      return true;
+    }
+  }
+  std::vector<uint64_t>().swap(DeferredMetadataInfo);
   return false;
 }
 
@@ -2850,12 +2891,15 @@ void BitcodeReader::Dematerialize(GlobalValue *GV) {
 bool BitcodeReader::MaterializeModule(Module *M, std::string *ErrInfo) {
   assert(M == TheModule &&
          "Can only Materialize the Module this BitcodeReader is attached to.");
+  if (MaterializeMetadata(ErrInfo))
+    return true;
+
   // Iterate over the module, deserializing any functions that are still on
-  // disk.
+  // disk.  The calls to upgraded intrinsics are rewritten once for all of
+  // them below.
   for (Module::iterator F = TheModule->begin(), E = TheModule->end();
        F != E; ++F)
-    if (F->isMaterializable() &&
-        Materialize(F, ErrInfo))
+    if (F->isMaterializable() && ParseDeferredFunctionBody(F, ErrInfo))
       return true;
 
   // At this point, if there are any function bodies, the current bit is
@@ -2864,10 +2908,10 @@ bool BitcodeReader::MaterializeModule(Module *M, std::string *ErrInfo) {
   if (NextUnreadBit)
     ParseModule(true);
 
-  // Upgrade any intrinsic calls that slipped through (should not happen!) and
-  // delete the old functions to clean up. We can't do this unless the entire
-  // module is materialized because there could always be another function body
-  // with calls to the old function.
+  // Now that the whole module is materialized, upgrade the calls to the old
+  // intrinsics in all of the bodies read above at once, and delete the old
+  // functions. This can't be done any earlier because there could always be
+  // another function body with calls to the old function.
   for (std::vector<std::pair<Function*, Function*> >::iterator I =
        UpgradedIntrinsics.begin(), E = UpgradedIntrinsics.end(); I != E; ++I) {
     if (I->first != I->second) {
@@ -2946,9 +2990,11 @@ bool BitcodeReader::InitLazyStream() {
 ///
 Module *llvm::getLazyBitcodeModule(MemoryBuffer *Buffer,
                                    LLVMContext& Context,
-                                   std::string *ErrMsg) {
+                                   std::string *ErrMsg,
+                                   bool LazyMetadata) {
   Module *M = new Module(Buffer->getBufferIdentifier(), Context);
   BitcodeReader *R = new BitcodeReader(Buffer, Context);
+  R->setLazyMetadata(LazyMetadata);
   M->setMaterializer(R);
   if (R->ParseBitcodeInto(M)) {
     if (ErrMsg)
@@ -173,6 +173,15 @@ class BitcodeReader : public GVMaterializer {
   /// map contains info about where to find deferred function body in the
   /// stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
+
+  /// LazyMetadata - If true, module-level metadata blocks are skipped while
+  /// the module is parsed and only read by MaterializeMetadata, which happens
+  /// at the latest before the first function body is read.
+  bool LazyMetadata;
+
+  /// DeferredMetadataInfo - The stream positions of the module-level metadata
+  /// blocks that have not been read yet.
+  std::vector<uint64_t> DeferredMetadataInfo;
   
   /// BlockAddrFwdRefs - These are blockaddr references to basic blocks.  These
   /// are resolved lazily when functions are loaded.
@@ -193,13 +202,15 @@ public:
     : Context(C), TheModule(0), Buffer(buffer), BufferOwned(false),
       LazyStreamer(0), NextUnreadBit(0), SeenValueSymbolTable(false),
       ErrorString(0), ValueList(C), MDValueList(C),
-      SeenFirstFunctionBody(false), UseRelativeIDs(false) {
+      SeenFirstFunctionBody(false), LazyMetadata(false),
+      UseRelativeIDs(false) {
   }
   explicit BitcodeReader(DataStreamer *streamer, LLVMContext &C)
     : Context(C), TheModule(0), Buffer(0), BufferOwned(false),
       LazyStreamer(streamer), NextUnreadBit(0), SeenValueSymbolTable(false),
       ErrorString(0), ValueList(C), MDValueList(C),
-      SeenFirstFunctionBody(false), UseRelativeIDs(false) {
+      SeenFirstFunctionBody(false), LazyMetadata(false),
+      UseRelativeIDs(false) {
   }
   ~BitcodeReader() {
     FreeState();
@@ -212,12 +223,17 @@ public:
   /// setBufferOwned - If this is true, the reader will destroy the MemoryBuffer
   /// when the reader is destroyed.
   void setBufferOwned(bool Owned) { BufferOwned = Owned; }
+
+  /// setLazyMetadata - If this is true, module-level metadata is not read
+  /// until it is materialized.  Must be set before the module is parsed.
+  void setLazyMetadata(bool Lazy) { LazyMetadata = Lazy; }
   
   virtual bool isMaterializable(const GlobalValue *GV) const;
   virtual bool isDematerializable(const GlobalValue *GV) const;
   virtual bool Materialize(GlobalValue *GV, std::string *ErrInfo = 0);
   virtual bool MaterializeModule(Module *M, std::string *ErrInfo = 0);
   virtual void Dematerialize(GlobalValue *GV);
+  virtual bool MaterializeMetadata(std::string *ErrInfo = 0);
 
   bool Error(const char *Str) {
     ErrorString = Str;
@@ -327,6 +343,8 @@ private:
   bool ParseConstants();
   bool RememberAndSkipFunctionBody();
   bool ParseFunctionBody(Function *F);
+  bool ParseDeferredFunctionBody(Function *F, std::string *ErrInfo);
+  void UpgradeIntrinsicCalls();
   bool GlobalCleanup();
   bool ResolveGlobalAndAliasInits();
   bool ParseMetadata();
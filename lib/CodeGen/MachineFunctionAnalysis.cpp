@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/CodeGen/MachineFunctionAnalysis.h"
+#include "llvm/Function.h"
 #include "llvm/CodeGen/GCMetadata.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
@@ -45,6 +46,15 @@ bool MachineFunctionAnalysis::doInitialization(Module &M) {
 
 bool MachineFunctionAnalysis::runOnFunction(Function &F) {
   assert(!MF && "MachineFunctionAnalysis already initialized!");
+  // 'available_externally' functions are never emitted, so no
+  // MachineFunctionPass will ask for their machine code.  Skip building the
+  // MachineFunction, but keep the function numbering stable so that labels in
+  // the surrounding functions do not depend on this.
+  if (F.hasAvailableExternallyLinkage()) {
+    ++NextFnNum;
+    return false;
+  }
+
   MF = new MachineFunction(&F, TM, NextFnNum++,
                            getAnalysis<MachineModuleInfo>(),
                            getAnalysisIfAvailable<GCModuleInfo>());
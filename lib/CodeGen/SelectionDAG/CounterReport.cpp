@@ -0,0 +1,73 @@
+//===-- CounterReport.cpp - Counters printed at exit ----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements CounterReport.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CounterReport.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
+using namespace llvm;
+
+namespace llvm { extern raw_ostream *CreateInfoOutputFile(); }
+
+uint64_t &CounterReport::getTotal(const char *Description) {
+  for (unsigned i = 0, e = Totals.size(); i != e; ++i)
+    if (!strcmp(Totals[i].first, Description))
+      return Totals[i].second;
+  Totals.push_back(std::make_pair(Description, uint64_t(0)));
+  return Totals.back().second;
+}
+
+namespace {
+  typedef std::pair<std::string, CounterReport::Counts> Row;
+
+  struct MoreFirst {
+    bool operator()(const Row &LHS, const Row &RHS) const {
+      if (LHS.second.First != RHS.second.First)
+        return LHS.second.First > RHS.second.First;
+      return LHS.first < RHS.first;
+    }
+  };
+}
+
+CounterReport::~CounterReport() {
+  bool Counted = !Rows.empty();
+  for (unsigned i = 0, e = Totals.size(); i != e; ++i)
+    Counted |= Totals[i].second != 0;
+  if (!Counted)
+    return;
+
+  std::vector<Row> Sorted;
+  for (StringMap<Counts>::const_iterator I = Rows.begin(), E = Rows.end();
+       I != E; ++I)
+    Sorted.push_back(std::make_pair(I->getKey().str(), I->getValue()));
+  std::sort(Sorted.begin(), Sorted.end(), MoreFirst());
+
+  // Center the title in the banner, as the statistics do.
+  raw_ostream &OS = *CreateInfoOutputFile();
+  OS << "===" << std::string(73, '-') << "===\n"
+     << std::string((80 - strlen(Title)) / 2, ' ') << Title << '\n'
+     << "===" << std::string(73, '-') << "===\n\n";
+  for (unsigned i = 0, e = Totals.size(); i != e; ++i)
+    OS << format("%12" PRIu64, Totals[i].second) << "  "
+       << Totals[i].first << '\n';
+  OS << '\n'
+     << format("%12s%12s", FirstHeading, SecondHeading) << "  "
+     << NameHeading << '\n';
+  for (unsigned i = 0, e = Sorted.size(); i != e; ++i)
+    OS << format("%12" PRIu64 "%12" PRIu64, Sorted[i].second.First,
+                 Sorted[i].second.Second)
+       << "  " << Sorted[i].first << '\n';
+  OS << '\n';
+  delete &OS;   // Close the file.
+}
@@ -0,0 +1,66 @@
+//===-- CounterReport.h - Counters printed at exit --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares CounterReport, the table behind the -combiner-report and
+// -fast-isel-report options.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CODEGEN_COUNTERREPORT_H
+#define LLVM_CODEGEN_COUNTERREPORT_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+#include <utility>
+#include <vector>
+
+namespace llvm {
+
+/// CounterReport - Counts accumulated over the whole run: a few totals, and a
+/// table with two counts per row keyed by name, e.g. per opcode. Like the
+/// statistics, the report is printed to the info output file when it is
+/// destroyed, so keep it in a ManagedStatic that llvm_shutdown destroys.
+/// Nothing is printed if nothing was counted.
+class CounterReport {
+public:
+  struct Counts {
+    uint64_t First;
+    uint64_t Second;
+    Counts() : First(0), Second(0) {}
+  };
+
+private:
+  const char *Title;
+  const char *FirstHeading;
+  const char *SecondHeading;
+  const char *NameHeading;
+  std::vector<std::pair<const char *, uint64_t> > Totals;
+  StringMap<Counts> Rows;
+
+public:
+  CounterReport(const char *Title, const char *FirstHeading,
+                const char *SecondHeading, const char *NameHeading)
+    : Title(Title), FirstHeading(FirstHeading), SecondHeading(SecondHeading),
+      NameHeading(NameHeading) {}
+  ~CounterReport();
+
+  /// getTotal - Returns the total with the given description. The totals are
+  /// printed above the table in the order they were first asked for. The
+  /// reference is only valid until the next call.
+  uint64_t &getTotal(const char *Description);
+
+  /// getRow - Returns the counts of the row with the given name. The rows are
+  /// printed sorted by their first count, highest first.
+  Counts &getRow(StringRef Name) { return Rows[Name]; }
+};
+
+} // end namespace llvm
+
+#endif
@@ -17,6 +17,7 @@
 //===----------------------------------------------------------------------===//
 
 #define DEBUG_TYPE "dagcombine"
+#include "CounterReport.h"
 #include "llvm/CodeGen/SelectionDAG.h"
 #include "llvm/DerivedTypes.h"
 #include "llvm/LLVMContext.h"
@@ -32,6 +33,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -52,6 +54,26 @@ namespace {
     CombinerGlobalAA("combiner-global-alias-analysis", cl::Hidden,
                cl::desc("Include global information in alias analysis"));
 
+  static cl::opt<bool>
+    CombinerTopologicalOrder("combiner-topological-order", cl::Hidden,
+               cl::desc("Visit the nodes of a DAG in topological order "
+                        "rather than in the order they were created"));
+
+  static cl::opt<bool>
+    CombinerReport("combiner-report", cl::Hidden,
+               cl::desc("Report the combines attempted and made per opcode, "
+                        "and how often nodes were revisited, at exit"));
+
+  /// CombineReport - The -combiner-report counts, accumulated over all
+  /// DAGCombiner runs: the combines attempted and made per opcode.
+  struct CombineReport : public CounterReport {
+    CombineReport()
+      : CounterReport("DAG Combiner Report", "Attempted", "Combined",
+                      "Opcode") {}
+  };
+
+  static ManagedStatic<CombineReport> Report;
+
 //------------------------------ DAGCombiner ---------------------------------//
 
   class DAGCombiner {
@@ -69,18 +91,17 @@ namespace {
     // also only appear once. The naive approach to this takes
     // linear time.
     //
-    // To reduce the insert/remove time to logarithmic, we use
-    // a set and a vector to maintain our worklist.
-    //
-    // The set contains the items on the worklist, but does not
-    // maintain the order they should be visited.
+    // Instead, each node on the worklist records one plus its position in
+    // WorkListOrder (see SDNode::getCombinerWorklistIndex). Adding a node
+    // that is already on the list, or removing one, clears its old entry to
+    // null, and nulls are skipped when popping. All operations are O(1).
     //
-    // The vector maintains the order nodes should be visited, but may
-    // contain duplicate or removed nodes. When choosing a node to
-    // visit, we pop off the order stack until we find an item that is
-    // also in the contents set. All operations are O(log N).
-    SmallPtrSet<SDNode*, 64> WorkListContents;
+    // Run numbers the nodes of the DAG in the order it adds them (see
+    // AddAllNodesToWorkList). Nodes created while combining get the next
+    // free number when they are first added, so node ids stay unique for
+    // the whole run.
     SmallVector<SDNode*, 64> WorkListOrder;
+    int NextNodeId;
 
     // AA - Used for DAG load/store alias analysis.
     AliasAnalysis &AA;
@@ -95,6 +116,11 @@ namespace {
         AddToWorkList(*UI);
     }
 
+    /// AddAllNodesToWorkList - Number all nodes of the DAG, in topological
+    /// order with -combiner-topological-order, and add them to the work list
+    /// in that order.
+    void AddAllNodesToWorkList();
+
     /// visit - call the node-specific routine that knows how to fold each
     /// particular type of node.
     SDValue visit(SDNode *N);
@@ -103,14 +129,20 @@ namespace {
     /// AddToWorkList - Add to the work list making sure its instance is at the
     /// back (next to be processed.)
     void AddToWorkList(SDNode *N) {
-      WorkListContents.insert(N);
+      removeFromWorkList(N);
+      if (N->getNodeId() < 0)
+        N->setNodeId(NextNodeId++);
       WorkListOrder.push_back(N);
+      N->setCombinerWorklistIndex(WorkListOrder.size());
     }
 
     /// removeFromWorkList - remove all instances of N from the worklist.
     ///
     void removeFromWorkList(SDNode *N) {
-      WorkListContents.erase(N);
+      if (unsigned Idx = N->getCombinerWorklistIndex()) {
+        WorkListOrder[Idx - 1] = 0;
+        N->setCombinerWorklistIndex(0);
+      }
     }
 
     SDValue CombineTo(SDNode *N, const SDValue *To, unsigned NumTo,
@@ -311,7 +343,8 @@ namespace {
   public:
     DAGCombiner(SelectionDAG &D, AliasAnalysis &A, CodeGenOpt::Level OL)
       : DAG(D), TLI(D.getTargetLoweringInfo()), Level(BeforeLegalizeTypes),
-        OptLevel(OL), LegalOperations(false), LegalTypes(false), AA(A) {}
+        OptLevel(OL), LegalOperations(false), LegalTypes(false), NextNodeId(0),
+        AA(A) {}
 
     /// Run - runs the dag combiner on all nodes in the work list
     void Run(CombineLevel AtLevel);
@@ -979,6 +1012,52 @@ bool DAGCombiner::PromoteLoad(SDValue Op) {
 //  Main DAG Combiner implementation
 //===----------------------------------------------------------------------===//
 
+void DAGCombiner::AddAllNodesToWorkList() {
+  NextNodeId = 0;
+  if (!CombinerTopologicalOrder) {
+    for (SelectionDAG::allnodes_iterator I = DAG.allnodes_begin(),
+         E = DAG.allnodes_end(); I != E; ++I) {
+      I->setNodeId(NextNodeId++);
+      AddToWorkList(I);
+    }
+    return;
+  }
+
+  // Nodes are normally created after their operands, but replacing operands
+  // can break that. Walk the node list depth first, emitting the operands of
+  // a node before the node itself, so that the order of the list is kept
+  // wherever it is already topological. A node id of -1 marks the nodes not
+  // reached yet, and -2 the ones whose operands are being emitted.
+  for (SelectionDAG::allnodes_iterator I = DAG.allnodes_begin(),
+       E = DAG.allnodes_end(); I != E; ++I)
+    I->setNodeId(-1);
+
+  SmallVector<std::pair<SDNode*, unsigned>, 32> Stack;
+  for (SelectionDAG::allnodes_iterator I = DAG.allnodes_begin(),
+       E = DAG.allnodes_end(); I != E; ++I) {
+    if (I->getNodeId() != -1)
+      continue;
+    I->setNodeId(-2);
+    Stack.push_back(std::make_pair(&*I, 0U));
+    while (!Stack.empty()) {
+      SDNode *N = Stack.back().first;
+      unsigned OpNo = Stack.back().second;
+      if (OpNo == N->getNumOperands()) {
+        Stack.pop_back();
+        N->setNodeId(NextNodeId++);
+        AddToWorkList(N);
+        continue;
+      }
+      ++Stack.back().second;
+      SDNode *Op = N->getOperand(OpNo).getNode();
+      if (Op->getNodeId() == -1) {
+        Op->setNodeId(-2);
+        Stack.push_back(std::make_pair(Op, 0U));
+      }
+    }
+  }
+}
+
 void DAGCombiner::Run(CombineLevel AtLevel) {
   // set the instance variables, so that the various visit routines may use it.
   Level = AtLevel;
@@ -986,9 +1065,7 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
   LegalTypes = Level >= AfterLegalizeTypes;
 
   // Add all the dag nodes to the worklist.
-  for (SelectionDAG::allnodes_iterator I = DAG.allnodes_begin(),
-       E = DAG.allnodes_end(); I != E; ++I)
-    AddToWorkList(I);
+  AddAllNodesToWorkList();
 
   // Create a dummy node (which is not added to allnodes), that adds a reference
   // to the root node, preventing it from being deleted, and tracking any
@@ -999,17 +1076,20 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
   // done.  Set it to null to avoid confusion.
   DAG.setRoot(SDValue());
 
+  // Number of times each node was visited, by node id, for -combiner-report.
+  // Node ids stay unique while combining, unlike the addresses of nodes that
+  // are deleted and recycled.
+  std::vector<unsigned> VisitCounts;
+
   // while the worklist isn't empty, find a node and
   // try and combine it.
-  while (!WorkListContents.empty()) {
-    SDNode *N;
-    // The WorkListOrder holds the SDNodes in order, but it may contain duplicates.
-    // In order to avoid a linear scan, we use a set (O(log N)) to hold what the
-    // worklist *should* contain, and check the node we want to visit is should
-    // actually be visited.
-    do {
-      N = WorkListOrder.pop_back_val();
-    } while (!WorkListContents.erase(N));
+  while (!WorkListOrder.empty()) {
+    // Entries of nodes that were removed from the worklist, or added to it
+    // again later, have been cleared.
+    SDNode *N = WorkListOrder.pop_back_val();
+    if (!N)
+      continue;
+    N->setCombinerWorklistIndex(0);
 
     // If N has no uses, it is dead.  Make sure to revisit all N's operands once
     // N is deleted from the DAG, since they too may now be dead or may have a
@@ -1022,12 +1102,24 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
       continue;
     }
 
+    CounterReport::Counts *Counts = 0;
+    if (CombinerReport) {
+      unsigned Id = N->getNodeId();
+      if (Id >= VisitCounts.size())
+        VisitCounts.resize(std::max(Id + 1, unsigned(NextNodeId)));
+      ++VisitCounts[Id];
+      Counts = &Report->getRow(N->getOperationName(&DAG));
+      ++Counts->First;
+    }
+
     SDValue RV = combine(N);
 
     if (RV.getNode() == 0)
       continue;
 
     ++NodesCombined;
+    if (Counts)
+      ++Counts->Second;
 
     // If we get back the same node we passed in, rather than a new node or
     // zero, we know that the node must have defined multiple values and
@@ -1084,6 +1176,21 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
   // If the root changed (e.g. it was a dead load, update the root).
   DAG.setRoot(Dummy.getValue());
   DAG.RemoveDeadNodes();
+
+  if (CombinerReport) {
+    uint64_t Visits = 0, Distinct = 0, MaxVisits = 0;
+    for (unsigned i = 0, e = VisitCounts.size(); i != e; ++i) {
+      if (!VisitCounts[i])
+        continue;
+      Visits += VisitCounts[i];
+      ++Distinct;
+      MaxVisits = std::max(MaxVisits, uint64_t(VisitCounts[i]));
+    }
+    Report->getTotal("node visits") += Visits;
+    Report->getTotal("distinct nodes visited") += Distinct;
+    uint64_t &MostVisits = Report->getTotal("most visits of one node");
+    MostVisits = std::max(MostVisits, MaxVisits);
+  }
 }
 
 SDValue DAGCombiner::visit(SDNode *N) {
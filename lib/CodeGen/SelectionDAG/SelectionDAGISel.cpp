@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #define DEBUG_TYPE "isel"
+#include "CounterReport.h"
 #include "ScheduleDAGSDNodes.h"
 #include "SelectionDAGBuilder.h"
 #include "llvm/Constants.h"
@@ -49,6 +50,7 @@
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/ADT/PostOrderIterator.h"
@@ -61,6 +63,13 @@ STATISTIC(NumFastIselSuccess, "Number of instructions fast isel selected");
 STATISTIC(NumFastIselBlocks, "Number of blocks selected entirely by fast isel");
 STATISTIC(NumDAGBlocks, "Number of blocks selected using DAG");
 STATISTIC(NumDAGIselRetries,"Number of times dag isel has to try another path");
+STATISTIC(NumDAGRegions, "Number of extra DAGs built by splitting large blocks");
+STATISTIC(NumOverBudgetFunctions,
+          "Number of functions that went over the isel node budget");
+STATISTIC(NumOverBudgetFastSched,
+          "Number of DAGs scheduled by the fast scheduler over budget");
+STATISTIC(NumOverBudgetFastISel,
+          "Number of blocks given to fast isel over budget");
 
 #ifndef NDEBUG
 static cl::opt<bool>
@@ -144,6 +153,21 @@ static cl::opt<bool>
 EnableFastISelAbort("fast-isel-abort", cl::Hidden,
           cl::desc("Enable abort calls when \"fast\" instruction fails"));
 
+static cl::opt<bool>
+EnableFastISelReport("fast-isel-report", cl::Hidden,
+          cl::desc("Report, at exit, the instructions that made the \"fast\" "
+                   "instruction selector fall back to SelectionDAG"));
+
+static cl::opt<unsigned>
+DAGRegionSize("isel-max-dag-region-size", cl::Hidden, cl::init(0),
+          cl::desc("Split basic blocks into SelectionDAGs of at most this many "
+                   "instructions (0 = unlimited)"));
+static cl::opt<unsigned>
+ISelNodeBudget("isel-node-budget", cl::Hidden, cl::init(0),
+          cl::desc("Once the SelectionDAGs of a function have had this many "
+                   "nodes, use the fast scheduler and fast isel for the rest "
+                   "of it (0 = unlimited)"));
+
 static cl::opt<bool>
 UseMBPI("use-mbpi",
         cl::desc("use Machine Branch Probability Info"),
@@ -271,7 +295,7 @@ SelectionDAGISel::SelectionDAGISel(const TargetMachine &tm,
   SDB(new SelectionDAGBuilder(*CurDAG, *FuncInfo, OL)),
   GFI(),
   OptLevel(OL),
-  DAGSize(0) {
+  DAGSize(0), DAGNodesInFunction(0) {
     initializeGCModuleInfoPass(*PassRegistry::getPassRegistry());
     initializeAliasAnalysisAnalysisGroup(*PassRegistry::getPassRegistry());
     initializeBranchProbabilityInfoPass(*PassRegistry::getPassRegistry());
@@ -364,6 +388,7 @@ bool SelectionDAGISel::runOnMachineFunction(MachineFunction &mf) {
 
   SDB->init(GFI, *AA, LibInfo);
 
+  DAGNodesInFunction = 0;
   SelectAllBasicBlocks(Fn);
 
   // If the first basic block in the function has live ins that need to be
@@ -486,22 +511,64 @@ bool SelectionDAGISel::runOnMachineFunction(MachineFunction &mf) {
   return true;
 }
 
+/// ExportRegionValues - Assign virtual registers to the values defined in
+/// [Begin, End) so that later DAGs for the same block can refer to them.
+static void ExportRegionValues(BasicBlock::const_iterator Begin,
+                               BasicBlock::const_iterator End,
+                               FunctionLoweringInfo &FuncInfo) {
+  for (BasicBlock::const_iterator I = Begin; I != End; ++I) {
+    if (I->use_empty() || I->getType()->isEmptyTy())
+      continue;
+    // Static allocas are referred to by frame index from any DAG.
+    if (const AllocaInst *AI = dyn_cast<AllocaInst>(I))
+      if (FuncInfo.StaticAllocaMap.count(AI))
+        continue;
+    unsigned &R = FuncInfo.ValueMap[I];
+    if (!R)
+      R = FuncInfo.CreateRegs(I->getType());
+  }
+}
+
 void SelectionDAGISel::SelectBasicBlock(BasicBlock::const_iterator Begin,
                                         BasicBlock::const_iterator End,
                                         bool &HadTailCall) {
-  // Lower all of the non-terminator instructions. If a call is emitted
-  // as a tail call, cease emitting nodes for this block. Terminators
-  // are handled below.
-  for (BasicBlock::const_iterator I = Begin; I != End && !SDB->HasTailCall; ++I)
-    SDB->visit(*I);
-
-  // Make sure the root of the DAG is up-to-date.
-  CurDAG->setRoot(SDB->getControlRoot());
-  HadTailCall = SDB->HasTailCall;
-  SDB->clear();
-
-  // Final step, emit the lowered DAG as machine code.
-  CodeGenAndEmitDAG();
+  // Combining, legalization and scheduling are superlinear in the size of the
+  // DAG, so very large blocks may be split into several DAGs.
+  while (true) {
+    BasicBlock::const_iterator RegionEnd = End;
+    if (DAGRegionSize) {
+      RegionEnd = Begin;
+      for (unsigned i = 0; i != DAGRegionSize && RegionEnd != End; ++i)
+        ++RegionEnd;
+      if (RegionEnd != End) {
+        ExportRegionValues(Begin, RegionEnd, *FuncInfo);
+        ++NumDAGRegions;
+      }
+    }
+
+    // Lower all of the non-terminator instructions. If a call is emitted
+    // as a tail call, cease emitting nodes for this block. Terminators
+    // are handled below.
+    for (BasicBlock::const_iterator I = Begin;
+         I != RegionEnd && !SDB->HasTailCall; ++I)
+      SDB->visit(*I);
+
+    // Make sure the root of the DAG is up-to-date.
+    CurDAG->setRoot(SDB->getControlRoot());
+    HadTailCall = SDB->HasTailCall;
+    SDB->clear();
+
+    // Final step, emit the lowered DAG as machine code.
+    CodeGenAndEmitDAG();
+
+    if (RegionEnd == End || HadTailCall)
+      return;
+    Begin = RegionEnd;
+  }
+}
+
+bool SelectionDAGISel::isOverNodeBudget() const {
+  return ISelNodeBudget && DAGNodesInFunction > ISelNodeBudget;
 }
 
 void SelectionDAGISel::ComputeLiveOutVRegInfo() {
@@ -565,6 +632,14 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   DEBUG(dbgs() << "Initial selection DAG: BB#" << BlockNumber
         << " '" << BlockName << "'\n"; CurDAG->dump());
 
+  bool WasOverBudget = isOverNodeBudget();
+  DAGNodesInFunction += CurDAG->allnodes_size();
+  if (!WasOverBudget && isOverNodeBudget()) {
+    ++NumOverBudgetFunctions;
+    DEBUG(dbgs() << "Function '" << MF->getName() << "' is over the isel node "
+                 << "budget after " << DAGNodesInFunction << " nodes\n");
+  }
+
   if (ViewDAGCombine1) CurDAG->viewGraph("dag-combine1 input for " + BlockName);
 
   // Run the DAG combiner in pre-legalize mode.
@@ -900,6 +975,60 @@ static bool isFoldedOrDeadInstruction(const Instruction *I,
          !FuncInfo->isExportedInst(I); // Exported instrs must be computed.
 }
 
+namespace {
+  /// FastISelMissReport - The -fast-isel-report counts, accumulated over all
+  /// functions.  Unlike the NumFastIselFail* statistics they are available
+  /// in release builds, and they are keyed by what FastISel could not handle
+  /// rather than just the opcode: calls are broken down by intrinsic, and
+  /// vector forms of an instruction are counted separately.  Each row counts
+  /// the times FastISel gave up on such an instruction and the instructions
+  /// SelectionDAG selected as a result.
+  struct FastISelMissReport : public CounterReport {
+    static const char *const FastISelSelected;
+    static const char *const DAGSelected;
+
+    FastISelMissReport()
+      : CounterReport("Fast Instruction Selection Misses", "Misses",
+                      "DAG Insts", "Instruction") {
+      // Print the totals in this order.
+      getTotal(FastISelSelected);
+      getTotal(DAGSelected);
+    }
+  };
+
+  const char *const FastISelMissReport::FastISelSelected =
+    "instructions selected by fast isel";
+  const char *const FastISelMissReport::DAGSelected =
+    "instructions selected by SelectionDAG";
+}
+
+static ManagedStatic<FastISelMissReport> MissReport;
+
+/// recordFastISelMiss - Note for -fast-isel-report that FastISel could not
+/// select I, and that NumDAGInsts instructions went to SelectionDAG instead.
+static void recordFastISelMiss(const Instruction *I, unsigned NumDAGInsts) {
+  std::string Reason;
+  if (const IntrinsicInst *II = dyn_cast<IntrinsicInst>(I)) {
+    Reason = "call @" + II->getCalledFunction()->getName().str();
+  } else if (const CallInst *CI = dyn_cast<CallInst>(I)) {
+    Reason = "call";
+    if (CI->isInlineAsm())
+      Reason += " (inline asm)";
+    else if (!CI->getCalledFunction())
+      Reason += " (indirect)";
+  } else {
+    Reason = I->getOpcodeName();
+  }
+  if (I->getType()->isVectorTy() ||
+      (I->getNumOperands() && I->getOperand(0)->getType()->isVectorTy()))
+    Reason += " (vector)";
+
+  CounterReport::Counts &Counts = MissReport->getRow(Reason);
+  ++Counts.First;
+  Counts.Second += NumDAGInsts;
+  MissReport->getTotal(FastISelMissReport::DAGSelected) += NumDAGInsts;
+}
+
 #ifndef NDEBUG
 // Collect per Instruction statistics for fast-isel misses.  Only those
 // instructions that cause the bail are accounted for.  It does not account for
@@ -985,6 +1114,7 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
   FastISel *FastIS = 0;
   if (TM.Options.EnableFastISel)
     FastIS = TLI.createFastISel(*FuncInfo, LibInfo);
+  bool FastISelForBudget = false;
 
   // Iterate over all basic blocks in the function.
   ReversePostOrderTraversal<const Function*> RPOT(&Fn);
@@ -1032,6 +1162,15 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
     if (LLVMBB == &Fn.getEntryBlock())
       LowerArguments(LLVMBB);
 
+    // Once over the node budget, let fast isel select as much as it can of
+    // the rest of the function, if the target has one.
+    if (!FastIS && isOverNodeBudget()) {
+      FastIS = TLI.createFastISel(*FuncInfo, LibInfo);
+      FastISelForBudget = FastIS != 0;
+    }
+    if (FastISelForBudget)
+      ++NumOverBudgetFastISel;
+
     // Before doing SelectionDAG ISel, see if FastISel has been requested.
     if (FastIS) {
       FastIS->startNewBlock();
@@ -1071,6 +1210,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
         if (FastIS->SelectInstruction(Inst)) {
           --NumFastIselRemaining;
           ++NumFastIselSuccess;
+          if (EnableFastISelReport)
+            ++MissReport->getTotal(FastISelMissReport::FastISelSelected);
           // If fast isel succeeded, skip over all the folded instructions, and
           // then see if there is a load right before the selected instructions.
           // Try to fold the load if so.
@@ -1087,6 +1228,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
             BI = llvm::next(BasicBlock::const_iterator(BeforeInst));
             --NumFastIselRemaining;
             ++NumFastIselSuccess;
+            if (EnableFastISelReport)
+              ++MissReport->getTotal(FastISelMissReport::FastISelSelected);
           }
           continue;
         }
@@ -1117,6 +1260,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
           // selection may have handled the call, input args, etc.
           unsigned RemainingNow = std::distance(Begin, BI);
           NumFastIselFailures += NumFastIselRemaining - RemainingNow;
+          if (EnableFastISelReport)
+            recordFastISelMiss(Inst, 1);
 
           // If the call was emitted as a tail call, we're done with the block.
           if (HadTailCall) {
@@ -1128,6 +1273,9 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
           continue;
         }
 
+        if (EnableFastISelReport)
+          recordFastISelMiss(Inst, NumFastIselRemaining);
+
         if (isa<TerminatorInst>(Inst) && !isa<BranchInst>(Inst)) {
           // Don't abort, and use a different message for terminator misses.
           NumFastIselFailures += NumFastIselRemaining;
@@ -1406,6 +1554,12 @@ SelectionDAGISel::FinishBasicBlock() {
 /// one preferred by the target.
 ///
 ScheduleDAGSDNodes *SelectionDAGISel::CreateScheduler() {
+  // Over the node budget, trade schedule quality for compile time.
+  if (isOverNodeBudget()) {
+    ++NumOverBudgetFastSched;
+    return createFastDAGScheduler(this, OptLevel);
+  }
+
   RegisterScheduler::FunctionPassCtor Ctor = RegisterScheduler::getDefault();
 
   if (!Ctor) {
@@ -2252,6 +2406,11 @@ SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
   // indicates where to continue checking.
   SmallVector<MatchScope, 8> MatchScopes;
 
+  // NumRetries - Failed scope children, added to NumDAGIselRetries once the
+  // node is done.  Bumping a Statistic is an atomic add and a memory fence,
+  // which is too slow to do every time a child fails.
+  unsigned NumRetries = 0;
+
   // RecordedNodes - This is the set of nodes that have been recorded by the
   // state machine.  The second value is the parent of the node, or null if the
   // root is recorded.
@@ -2357,7 +2516,7 @@ SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
         DEBUG(errs() << "  Skipped scope entry (due to false predicate) at "
                      << "index " << MatcherIndexOfPredicate
                      << ", continuing at " << FailIndex << "\n");
-        ++NumDAGIselRetries;
+        ++NumRetries;
 
         // Otherwise, we know that this case of the Scope is guaranteed to fail,
         // move to the next case.
@@ -2368,8 +2527,9 @@ SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
       if (FailIndex == 0) break;
 
       // Push a MatchScope which indicates where to go if the first child fails
-      // to match.
-      MatchScope NewEntry;
+      // to match.  Fill it in place, the node stack is not cheap to copy.
+      MatchScopes.push_back(MatchScope());
+      MatchScope &NewEntry = MatchScopes.back();
       NewEntry.FailIndex = FailIndex;
       NewEntry.NodeStack.append(NodeStack.begin(), NodeStack.end());
       NewEntry.NumRecordedNodes = RecordedNodes.size();
@@ -2378,7 +2538,6 @@ SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
       NewEntry.InputGlue = InputGlue;
       NewEntry.HasChainNodesMatched = !ChainNodesMatched.empty();
       NewEntry.HasGlueResultNodesMatched = !GlueResultNodesMatched.empty();
-      MatchScopes.push_back(NewEntry);
       continue;
     }
     case OPC_RecordNode: {
@@ -2800,6 +2959,7 @@ SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
         // NodeToMatch was eliminated by CSE when the target changed the DAG.
         // We will visit the equivalent node later.
         DEBUG(dbgs() << "Node was eliminated by CSE\n");
+        NumDAGIselRetries += NumRetries;
         return 0;
       }
 
@@ -2869,6 +3029,7 @@ SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
         // Update chain and glue uses.
         UpdateChainsAndGlue(NodeToMatch, InputChain, ChainNodesMatched,
                             InputGlue, GlueResultNodesMatched, true);
+        NumDAGIselRetries += NumRetries;
         return Res;
       }
 
@@ -2930,6 +3091,7 @@ SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
 
       // FIXME: We just return here, which interacts correctly with SelectRoot
       // above.  We should fix this to not return an SDNode* anymore.
+      NumDAGIselRetries += NumRetries;
       return 0;
     }
     }
@@ -2938,7 +3100,7 @@ SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
     // another child to try in the current 'Scope', otherwise pop it until we
     // find a case to check.
     DEBUG(errs() << "  Match failed at index " << CurrentOpcodeIndex << "\n");
-    ++NumDAGIselRetries;
+    ++NumRetries;
     while (1) {
       if (MatchScopes.empty()) {
         CannotYetSelect(NodeToMatch);
@@ -15,6 +15,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetInstrInfo.h"
+#include <algorithm>
 
 using namespace llvm;
 
@@ -25,6 +26,10 @@ INITIALIZE_PASS(SlotIndexes, "slotindexes",
 STATISTIC(NumLocalRenum,  "Number of local renumberings");
 STATISTIC(NumGlobalRenum, "Number of global renumberings");
 
+/// MaxCatchUpEntries - The number of entries a local renumbering may push
+/// forward before it spreads out a wider window instead.
+static const unsigned MaxCatchUpEntries = 8;
+
 void SlotIndexes::getAnalysisUsage(AnalysisUsage &au) const {
   au.setPreservesAll();
   MachineFunctionPass::getAnalysisUsage(au);
@@ -125,23 +130,72 @@ void SlotIndexes::renumberIndexes() {
 // Renumber indexes locally after curItr was inserted, but failed to get a new
 // index.
 void SlotIndexes::renumberIndexes(IndexList::iterator curItr) {
-  // Number indexes with half the default spacing so we can catch up quickly.
-  const unsigned Space = SlotIndex::InstrDist/2;
-  assert((Space & 3) == 0 && "InstrDist must be a multiple of 2*NUM");
-
-  IndexList::iterator startItr = prior(curItr);
-  unsigned index = startItr->getIndex();
-  do {
-    curItr->setIndex(index += Space);
-    ++curItr;
-    // If the next index is bigger, we have caught up.
-  } while (curItr != indexList.end() && curItr->getIndex() <= index);
-
-  DEBUG(dbgs() << "\n*** Renumbered SlotIndexes " << startItr->getIndex() << '-'
+  IndexList::iterator startItr = prior(curItr), endItr = llvm::next(curItr);
+  unsigned startIndex = startItr->getIndex();
+  unsigned numEntries = 1;
+
+  // Most collisions are isolated: numbering a few entries with half the
+  // default spacing catches up with the existing indexes.
+  unsigned space = SlotIndex::InstrDist/2;
+  assert((space & 3) == 0 && "InstrDist must be a multiple of 2*NUM");
+  while (endItr != indexList.end() &&
+         endItr->getIndex() <= startIndex + space * numEntries) {
+    if (numEntries == MaxCatchUpEntries) {
+      space = spreadWindow(startItr, endItr, numEntries);
+      startIndex = startItr->getIndex();
+      break;
+    }
+    ++endItr;
+    ++numEntries;
+  }
+
+  unsigned index = startIndex;
+  for (IndexList::iterator I = llvm::next(startItr); I != endItr; ++I)
+    I->setIndex(index += space);
+
+  DEBUG(dbgs() << "\n*** Renumbered SlotIndexes " << startIndex << '-'
                << index << " ***\n");
   ++NumLocalRenum;
 }
 
+// Pushing the collision forward entry by entry is quadratic when many
+// instructions are inserted at the same point, as the splitter and the spiller
+// tend to do: every insertion would move the same growing run of tightly
+// packed indexes again.  Instead, grow the window around the collision
+// geometrically until the indexes bounding it leave enough room to
+// spread it out evenly.  The spacing a window must reach grows with its size,
+// so a large window is renumbered with enough slack that its parts absorb
+// many further insertions before they overflow again.  Returns the spacing to
+// use for the entries strictly between startItr and endItr.
+unsigned SlotIndexes::spreadWindow(IndexList::iterator &startItr,
+                                   IndexList::iterator &endItr,
+                                   unsigned &numEntries) {
+  const unsigned maxSpace = 4 * SlotIndex::InstrDist;
+  for (unsigned minSpace = SlotIndex::InstrDist/2;;
+       minSpace = std::min(minSpace + SlotIndex::InstrDist/4, maxSpace)) {
+    // Extend the window by numEntries on each side, where possible.  The
+    // first entry always keeps index 0, so it can bound the window.
+    for (unsigned i = 0, e = numEntries; i != e; ++i) {
+      if (startItr != indexList.begin()) {
+        --startItr;
+        ++numEntries;
+      }
+      if (endItr != indexList.end()) {
+        ++endItr;
+        ++numEntries;
+      }
+    }
+
+    // There is always room after the last entry.
+    if (endItr == indexList.end())
+      return std::max(minSpace, unsigned(SlotIndex::InstrDist));
+
+    unsigned space =
+      ((endItr->getIndex() - startItr->getIndex()) / (numEntries + 1)) & ~3u;
+    if (space >= minSpace)
+      return space;
+  }
+}
 
 #if !defined(NDEBUG) || defined(LLVM_ENABLE_DUMP)
 void SlotIndexes::dump() const {
@@ -91,6 +91,9 @@ void DWARFCompileUnit::clear() {
   Abbrevs = 0;
   AddrSize = 0;
   BaseAddr = 0;
+  SubprogramRanges.clear();
+  RangeListSubprograms.clear();
+  SubprogramIndexBuilt = false;
   clearDIEs(false);
 }
 
@@ -115,11 +118,13 @@ const char *DWARFCompileUnit::getCompilationDir() {
   return DieArray[0].getAttributeValueAsString(this, DW_AT_comp_dir, 0);
 }
 
-void DWARFCompileUnit::setDIERelations() {
-  if (DieArray.empty())
+/// setDIERelations - Sets the parent and sibling links of a tree of DIEs that
+/// was parsed in order into DIEs.
+static void setDIERelations(std::vector<DWARFDebugInfoEntryMinimal> &DIEs) {
+  if (DIEs.empty())
     return;
-  DWARFDebugInfoEntryMinimal *die_array_begin = &DieArray.front();
-  DWARFDebugInfoEntryMinimal *die_array_end = &DieArray.back();
+  DWARFDebugInfoEntryMinimal *die_array_begin = &DIEs.front();
+  DWARFDebugInfoEntryMinimal *die_array_end = &DIEs.back();
   DWARFDebugInfoEntryMinimal *curr_die;
   // We purposely are skipping the last element in the array in the loop below
   // so that we can always have a valid next item
@@ -150,6 +155,10 @@ void DWARFCompileUnit::setDIERelations() {
     curr_die->setParent(die_array_begin);
 }
 
+void DWARFCompileUnit::setDIERelations() {
+  ::setDIERelations(DieArray);
+}
+
 size_t DWARFCompileUnit::extractDIEsIfNeeded(bool cu_die_only) {
   const size_t initial_die_array_size = DieArray.size();
   if ((cu_die_only && initial_die_array_size > 0) ||
@@ -218,7 +227,36 @@ size_t DWARFCompileUnit::extractDIEsIfNeeded(bool cu_die_only) {
   return DieArray.size();
 }
 
+bool DWARFCompileUnit::extractSubtree(uint32_t offset,
+                      std::vector<DWARFDebugInfoEntryMinimal> &DIEs) const {
+  DIEs.clear();
+  uint32_t next_cu_offset = getNextCompileUnitOffset();
+  const uint8_t *fixed_form_sizes =
+    DWARFFormValue::getFixedFormSizesForAddressSize(getAddressByteSize());
+
+  DWARFDebugInfoEntryMinimal die;
+  uint32_t depth = 0;
+  while (offset < next_cu_offset &&
+         die.extractFast(this, fixed_form_sizes, &offset)) {
+    DIEs.push_back(die);
+    if (const DWARFAbbreviationDeclaration *abbrDecl =
+          die.getAbbreviationDeclarationPtr()) {
+      if (abbrDecl->hasChildren())
+        ++depth;
+    } else if (depth > 0) {
+      --depth;
+    }
+    if (depth == 0)
+      break; // We are done with this subtree.
+  }
+
+  ::setDIERelations(DIEs);
+  return !DIEs.empty() && !DIEs[0].isNULL();
+}
+
 void DWARFCompileUnit::clearDIEs(bool keep_compile_unit_die) {
+  std::vector<DWARFDebugInfoEntryMinimal>().swap(SubtreeDIEs);
+
   if (DieArray.size() > (unsigned)keep_compile_unit_die) {
     // std::vectors never get any smaller when resized to a smaller size,
     // or when clear() or erase() are called, the size will report that it
@@ -255,21 +293,61 @@ DWARFCompileUnit::buildAddressRangeTable(DWARFDebugAranges *debug_aranges,
     clearDIEs(true);
 }
 
+void DWARFCompileUnit::buildSubprogramIndex() {
+  SubprogramIndexBuilt = true;
+  // The whole unit has to be parsed once to find its subprograms, but, as in
+  // buildAddressRangeTable, don't keep the DIEs if nobody had asked for them.
+  const bool clear_dies = extractDIEsIfNeeded(false) > 1;
+  for (size_t i = 0, n = DieArray.size(); i != n; ++i) {
+    const DWARFDebugInfoEntryMinimal &DIE = DieArray[i];
+    if (!DIE.isSubprogramDIE())
+      continue;
+    uint32_t Offset = DIE.getOffset();
+    uint64_t LowPC, HighPC;
+    if (DIE.getLowAndHighPC(this, LowPC, HighPC))
+      SubprogramRanges.insert(LowPC, HighPC, Offset);
+    else if (DIE.getAttributeValueAsReference(this, DW_AT_ranges, -1U) != -1U)
+      RangeListSubprograms.push_back(Offset);
+  }
+  SubprogramRanges.finalize();
+
+  if (clear_dies)
+    clearDIEs(true);
+}
+
+uint32_t DWARFCompileUnit::findSubprogramForAddress(uint64_t Address) {
+  if (!SubprogramIndexBuilt)
+    buildSubprogramIndex();
+
+  // Of nested subprograms, take the innermost one; of several starting at
+  // the same address, the first in DIE order.
+  if (const uint32_t *Offset = SubprogramRanges.find(Address))
+    return *Offset;
+
+  // Subprograms with several address ranges are rare; check them one by one.
+  for (size_t i = 0, n = RangeListSubprograms.size(); i != n; ++i) {
+    uint32_t Offset = RangeListSubprograms[i];
+    DWARFDebugInfoEntryMinimal DIE;
+    if (DIE.extract(this, &Offset) &&
+        DIE.addressRangeContainsAddress(this, Address))
+      return RangeListSubprograms[i];
+  }
+  return -1U;
+}
+
 DWARFDebugInfoEntryMinimal::InlinedChain
 DWARFCompileUnit::getInlinedChainForAddress(uint64_t Address) {
   // First, find a subprogram that contains the given address (the root
   // of inlined chain).
-  extractDIEsIfNeeded(false);
-  const DWARFDebugInfoEntryMinimal *SubprogramDIE = 0;
-  for (size_t i = 0, n = DieArray.size(); i != n; i++) {
-    if (DieArray[i].isSubprogramDIE() &&
-        DieArray[i].addressRangeContainsAddress(this, Address)) {
-      SubprogramDIE = &DieArray[i];
-      break;
-    }
+  uint32_t SubprogramOffset = findSubprogramForAddress(Address);
+  if (SubprogramOffset == -1U)
+    return DWARFDebugInfoEntryMinimal::InlinedChain();
+  // Parse just the subtree of that subprogram, unless it is the one parsed
+  // for the previous lookup.
+  if (SubtreeDIEs.empty() || SubtreeDIEs[0].getOffset() != SubprogramOffset) {
+    if (!extractSubtree(SubprogramOffset, SubtreeDIEs))
+      return DWARFDebugInfoEntryMinimal::InlinedChain();
   }
   // Get inlined chain rooted at this subprogram DIE.
-  if (!SubprogramDIE)
-    return DWARFDebugInfoEntryMinimal::InlinedChain();
-  return SubprogramDIE->getInlinedChainForAddress(this, Address);
+  return SubtreeDIEs[0].getInlinedChainForAddress(this, Address);
 }
@@ -13,6 +13,7 @@
 #include "DWARFDebugAbbrev.h"
 #include "DWARFDebugInfoEntry.h"
 #include "DWARFDebugRangeList.h"
+#include "llvm/DebugInfo/AddressRangeIndex.h"
 #include <vector>
 
 namespace llvm {
@@ -31,6 +32,21 @@ class DWARFCompileUnit {
   uint64_t BaseAddr;
   // The compile unit debug information entry item.
   std::vector<DWARFDebugInfoEntryMinimal> DieArray;
+
+  // Offsets of the subprograms with a low and high pc, indexed by address
+  // so that the subprogram containing an address can be found without
+  // keeping all the DIEs of the unit parsed.
+  AddressRangeIndex<uint32_t> SubprogramRanges;
+  // Offsets of the subprograms described by DW_AT_ranges instead.
+  std::vector<uint32_t> RangeListSubprograms;
+  bool SubprogramIndexBuilt;
+  // The subprogram subtree parsed for the most recent address lookup.
+  std::vector<DWARFDebugInfoEntryMinimal> SubtreeDIEs;
+
+  void buildSubprogramIndex();
+  /// findSubprogramForAddress - Returns the offset of the subprogram DIE
+  /// containing Address, or -1U if there is none.
+  uint32_t findSubprogramForAddress(uint64_t Address);
 public:
   DWARFCompileUnit(DWARFContext &context) : Context(context) {
     clear();
@@ -46,6 +62,11 @@ public:
   /// extractDIEsIfNeeded - Parses a compile unit and indexes its DIEs if it
   /// hasn't already been done. Returns the number of DIEs parsed at this call.
   size_t extractDIEsIfNeeded(bool cu_die_only);
+  /// extractSubtree - Parses the DIE at the given offset and all of its
+  /// descendants into DIEs, replacing its previous contents, and links them
+  /// up. Returns false if there is no DIE at the offset.
+  bool extractSubtree(uint32_t offset,
+                      std::vector<DWARFDebugInfoEntryMinimal> &DIEs) const;
   /// extractRangeList - extracts the range list referenced by this compile
   /// unit from .debug_ranges section. Returns true on success.
   /// Requires that compile unit is already extracted.
@@ -108,6 +129,8 @@ public:
     DieArray.push_back(die);
   }
 
+  /// clearDIEs - Frees the parsed DIEs of this unit, except for the compile
+  /// unit DIE if requested. They are parsed again when needed.
   void clearDIEs(bool keep_compile_unit_die);
 
   void buildAddressRangeTable(DWARFDebugAranges *debug_aranges,
@@ -115,6 +138,7 @@ public:
 
   /// getInlinedChainForAddress - fetches inlined chain for a given address.
   /// Returns empty chain if there is no subprogram containing address.
+  /// Only the DIEs of the subprogram containing the address are kept parsed.
   DWARFDebugInfoEntryMinimal::InlinedChain getInlinedChainForAddress(
       uint64_t Address);
 };
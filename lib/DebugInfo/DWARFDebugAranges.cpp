@@ -44,13 +44,7 @@ namespace {
       for (uint32_t i=0; (arange_desc_ptr = set.getDescriptor(i)) != NULL; ++i){
         range.LoPC = arange_desc_ptr->Address;
         range.Length = arange_desc_ptr->Length;
-
-        // Insert each item in increasing address order so binary searching
-        // can later be done!
-        DWARFDebugAranges::RangeColl::iterator insert_pos =
-          std::lower_bound(RangeCollection.begin(), RangeCollection.end(),
-                           range, RangeLessThan);
-        RangeCollection.insert(insert_pos, range);
+        RangeCollection.push_back(range);
       }
     }
     DWARFDebugAranges::RangeColl& RangeCollection;
@@ -77,6 +71,9 @@ bool DWARFDebugAranges::extract(DataExtractor debug_aranges_data) {
       Aranges.reserve(count);
       AddArangeDescriptors range_adder(Aranges);
       std::for_each(sets.begin(), sets.end(), range_adder);
+      // Sort once all the descriptors are in, rather than inserting each one
+      // in place, which is quadratic in the number of ranges.
+      sort(true, /* overlap size */ 0);
     }
   }
   return false;
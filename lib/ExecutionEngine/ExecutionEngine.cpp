@@ -59,7 +59,9 @@ ExecutionEngine::ExecutionEngine(Module *M)
     ExceptionTableRegister(0),
     ExceptionTableDeregister(0) {
   CompilingLazily         = false;
+  UnitCompilationEnabled  = false;
   GVCompilationDisabled   = false;
+  TierUpThreshold         = 0;
   SymbolSearchingDisabled = false;
   Modules.push_back(M);
   assert(M && "Module is null?");
@@ -18,7 +18,9 @@
 #include "llvm/Instructions.h"
 #include "llvm/CodeGen/IntrinsicLowering.h"
 #include "llvm/Support/GetElementPtrTypeIterator.h"
+#include "llvm/Support/InstIterator.h"
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
@@ -38,7 +40,79 @@ static cl::opt<bool> PrintVolatile("interpreter-print-volatile", cl::Hidden,
 //===----------------------------------------------------------------------===//
 
 static void SetValue(Value *V, GenericValue Val, ExecutionContext &SF) {
-  SF.Values[V] = Val;
+  SF.getValue(V) = Val;
+}
+
+/// isAddressIndependent - Return true if the value of C does not depend on
+/// where globals are mapped, so it can be evaluated once.
+static bool isAddressIndependent(const Constant *C) {
+  if (isa<GlobalValue>(C) || isa<BlockAddress>(C) || isa<ConstantExpr>(C))
+    return false;
+  for (User::const_op_iterator I = C->op_begin(), E = C->op_end(); I != E; ++I)
+    if (!isAddressIndependent(cast<Constant>(*I)))
+      return false;
+  return true;
+}
+
+void FunctionInfo::decode(const Function *F) {
+  for (Function::const_arg_iterator AI = F->arg_begin(), E = F->arg_end();
+       AI != E; ++AI)
+    if (Slots.insert(std::make_pair(AI, NumSlots)).second)
+      ++NumSlots;
+  for (const_inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I)
+    if (!I->getType()->isVoidTy() &&
+        Slots.insert(std::make_pair(&*I, NumSlots)).second)
+      ++NumSlots;
+
+  Insts.clear();
+  OperandSlots.clear();
+  BlockStarts.clear();
+  for (Function::const_iterator BB = F->begin(), BE = F->end(); BB != BE;
+       ++BB) {
+    BlockStarts[BB] = Insts.size();
+    for (BasicBlock::const_iterator I = BB->begin(), E = BB->end(); I != E;
+         ++I) {
+      InstInfo II;
+      II.Inst = I;
+      II.Slot = I->getType()->isVoidTy() ? unsigned(NoSlot) : getSlot(I);
+      II.FirstOperand = OperandSlots.size();
+      Insts.push_back(II);
+      for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i) {
+        const Value *Op = I->getOperand(i);
+        unsigned Slot = NoSlot;
+        if (isa<Argument>(Op) || isa<Instruction>(Op)) {
+          Slot = getSlot(Op);
+        } else if (const Constant *C = dyn_cast<Constant>(Op)) {
+          if (isAddressIndependent(C)) {
+            std::pair<DenseMap<const Constant *, unsigned>::iterator, bool> R =
+              ConstantIndices.insert(std::make_pair(C, Constants.size()));
+            if (R.second)
+              Constants.push_back(C);
+            Slot = ConstantFlag | R.first->second;
+          }
+        }
+        OperandSlots.push_back(Slot);
+      }
+    }
+  }
+}
+
+FunctionInfo *Interpreter::getFunctionInfo(const Function *F) {
+  FunctionInfo *&FI = FunctionInfos[F];
+  if (!FI) {
+    FI = new FunctionInfo();
+    decodeFunction(FI, F);
+  }
+  return FI;
+}
+
+/// decodeFunction - Decode F into FI and evaluate the constants it added.
+void Interpreter::decodeFunction(FunctionInfo *FI, const Function *F) {
+  FI->decode(F);
+  for (unsigned i = FI->ConstantValues.size(), e = FI->Constants.size();
+       i != e; ++i)
+    FI->ConstantValues.push_back(
+      getConstantValue(const_cast<Constant*>(FI->Constants[i])));
 }
 
 //===----------------------------------------------------------------------===//
@@ -573,6 +647,7 @@ void Interpreter::exitCalled(GenericValue GV) {
   // if exit() was called, then it had a stack frame. Blow away
   // the stack before interpreting atexit handlers.
   ECStack.clear();
+  flushStatistics();
   runAtExitHandlers();
   exit(GV.IntVal.zextOrTrunc(32).getZExtValue());
 }
@@ -711,28 +786,37 @@ void Interpreter::SwitchToNewBasicBlock(BasicBlock *Dest, ExecutionContext &SF){
   BasicBlock *PrevBB = SF.CurBB;      // Remember where we came from...
   SF.CurBB   = Dest;                  // Update CurBB to branch destination
   SF.CurInst = SF.CurBB->begin();     // Update new instruction ptr...
+  SF.CurInstNo = SF.FuncInfo->BlockStarts.lookup(Dest);
 
   if (!isa<PHINode>(SF.CurInst)) return;  // Nothing fancy to do
 
   // Loop over all of the PHI nodes in the current block, reading their inputs.
-  std::vector<GenericValue> ResultValues;
+  SmallVector<GenericValue, 8> ResultValues;
 
-  for (; PHINode *PN = dyn_cast<PHINode>(SF.CurInst); ++SF.CurInst) {
+  const FunctionInfo::InstInfo *II = &SF.FuncInfo->Insts[SF.CurInstNo];
+  for (; PHINode *PN = dyn_cast<PHINode>(SF.CurInst); ++SF.CurInst, ++II) {
     // Search for the value corresponding to this previous bb...
     int i = PN->getBasicBlockIndex(PrevBB);
     assert(i != -1 && "PHINode doesn't contain entry for predecessor??");
     Value *IncomingValue = PN->getIncomingValue(i);
 
     // Save the incoming value for this PHI node...
-    ResultValues.push_back(getOperandValue(IncomingValue, SF));
+    unsigned Slot = SF.FuncInfo->OperandSlots[II->FirstOperand + i];
+    if (Slot == FunctionInfo::NoSlot)
+      ResultValues.push_back(getOperandValue(IncomingValue, SF));
+    else if (Slot & FunctionInfo::ConstantFlag)
+      ResultValues.push_back(
+        SF.FuncInfo->ConstantValues[Slot & ~FunctionInfo::ConstantFlag]);
+    else
+      ResultValues.push_back(SF.Values[Slot]);
   }
 
   // Now loop over all of the PHI nodes setting their values...
   SF.CurInst = SF.CurBB->begin();
-  for (unsigned i = 0; isa<PHINode>(SF.CurInst); ++SF.CurInst, ++i) {
-    PHINode *PN = cast<PHINode>(SF.CurInst);
-    SetValue(PN, ResultValues[i], SF);
-  }
+  II = &SF.FuncInfo->Insts[SF.CurInstNo];
+  for (unsigned i = 0; isa<PHINode>(SF.CurInst); ++SF.CurInst, ++II, ++i)
+    SF.Values[II->Slot] = ResultValues[i];
+  SF.CurInstNo += ResultValues.size();
 }
 
 //===----------------------------------------------------------------------===//
@@ -868,6 +952,14 @@ void Interpreter::visitCallSite(CallSite CS) {
       //
       BasicBlock::iterator me(CS.getInstruction());
       BasicBlock *Parent = CS.getInstruction()->getParent();
+
+      // Callers of this function may be about to execute the same call once
+      // we return to them; they have to resume at the lowered code as well.
+      SmallVector<ExecutionContext*, 4> WaitingFrames;
+      for (unsigned i = 0, e = ECStack.size() - 1; i != e; ++i)
+        if (ECStack[i].FuncInfo == SF.FuncInfo && ECStack[i].CurInst == me)
+          WaitingFrames.push_back(&ECStack[i]);
+
       bool atBegin(Parent->begin() == me);
       if (!atBegin)
         --me;
@@ -881,6 +973,20 @@ void Interpreter::visitCallSite(CallSite CS) {
         SF.CurInst = me;
         ++SF.CurInst;
       }
+      for (unsigned i = 0, e = WaitingFrames.size(); i != e; ++i)
+        WaitingFrames[i]->CurInst = SF.CurInst;
+
+      // Number the new instructions and update every frame of this function.
+      FunctionInfo *FI = SF.FuncInfo;
+      decodeFunction(FI, SF.CurFunction);
+      for (unsigned i = 0, e = ECStack.size(); i != e; ++i) {
+        ExecutionContext &Frame = ECStack[i];
+        if (Frame.FuncInfo != FI)
+          continue;
+        Frame.Values.resize(FI->NumSlots);
+        Frame.CurInstNo = FI->BlockStarts.lookup(Frame.CurBB) +
+          std::distance(Frame.CurBB->begin(), Frame.CurInst);
+      }
       return;
     }
 
@@ -1268,15 +1374,19 @@ GenericValue Interpreter::getConstantExprValue (ConstantExpr *CE,
 }
 
 GenericValue Interpreter::getOperandValue(Value *V, ExecutionContext &SF) {
-  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(V)) {
+  Constant *C = dyn_cast<Constant>(V);
+  if (!C)
+    return SF.getValue(V);
+
+  // Constants that do not refer to globals were evaluated when the function
+  // was decoded.
+  unsigned Slot = SF.findOperand(C);
+  if (Slot != FunctionInfo::NoSlot)
+    return SF.FuncInfo->ConstantValues[Slot & ~FunctionInfo::ConstantFlag];
+
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(C))
     return getConstantExprValue(CE, SF);
-  } else if (Constant *CPV = dyn_cast<Constant>(V)) {
-    return getConstantValue(CPV);
-  } else if (GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
-    return PTOGV(getPointerToGlobal(GV));
-  } else {
-    return SF.Values[V];
-  }
+  return getConstantValue(C);
 }
 
 //===----------------------------------------------------------------------===//
@@ -1308,30 +1418,40 @@ void Interpreter::callFunction(Function *F,
   StackFrame.CurBB     = F->begin();
   StackFrame.CurInst   = StackFrame.CurBB->begin();
 
+  // Lay out the value plane for this invocation.
+  StackFrame.FuncInfo  = getFunctionInfo(F);
+  StackFrame.Values.resize(StackFrame.FuncInfo->NumSlots);
+
   // Run through the function arguments and initialize their values...
   assert((ArgVals.size() == F->arg_size() ||
          (ArgVals.size() > F->arg_size() && F->getFunctionType()->isVarArg()))&&
          "Invalid number of values passed to function invocation!");
 
-  // Handle non-varargs arguments...
+  // Handle non-varargs arguments.  The arguments are numbered first, so they
+  // occupy the leading slots.
   unsigned i = 0;
-  for (Function::arg_iterator AI = F->arg_begin(), E = F->arg_end(); 
-       AI != E; ++AI, ++i)
-    SetValue(AI, ArgVals[i], StackFrame);
+  for (unsigned e = F->arg_size(); i != e; ++i)
+    StackFrame.Values[i] = ArgVals[i];
 
   // Handle varargs arguments...
   StackFrame.VarArgs.assign(ArgVals.begin()+i, ArgVals.end());
 }
 
 
+void Interpreter::flushStatistics() {
+  NumDynamicInsts += NumExecutedInsts;
+  NumExecutedInsts = 0;
+}
+
 void Interpreter::run() {
   while (!ECStack.empty()) {
     // Interpret a single instruction & increment the "PC".
     ExecutionContext &SF = ECStack.back();  // Current stack frame
     Instruction &I = *SF.CurInst++;         // Increment before execute
+    ++SF.CurInstNo;
 
     // Track the number of dynamic instructions executed.
-    ++NumDynamicInsts;
+    ++NumExecutedInsts;
 
     DEBUG(dbgs() << "About to interpret: " << I);
     visit(I);   // Dispatch to one of the visit* methods...
@@ -1341,7 +1461,7 @@ DEBUG(
     if (!isa<CallInst>(I) && !isa<InvokeInst>(I) && 
         I.getType() != Type::VoidTy) {
       dbgs() << "  --> ";
-      const GenericValue &Val = SF.Values[&I];
+      const GenericValue &Val = SF.getValue(&I);
       switch (I.getType()->getTypeID()) {
       default: llvm_unreachable("Invalid GenericValue Type");
       case Type::VoidTyID:    dbgs() << "void"; break;
@@ -1358,4 +1478,6 @@ DEBUG(
     });
 #endif
   }
+
+  flushStatistics();
 }
@@ -17,6 +17,7 @@
 #include "llvm/CodeGen/IntrinsicLowering.h"
 #include "llvm/DerivedTypes.h"
 #include "llvm/Module.h"
+#include "llvm/ADT/STLExtras.h"
 #include <cstring>
 using namespace llvm;
 
@@ -45,7 +46,7 @@ ExecutionEngine *Interpreter::create(Module *M, std::string* ErrStr) {
 // Interpreter ctor - Initialize stuff
 //
 Interpreter::Interpreter(Module *M)
-  : ExecutionEngine(M), TD(M) {
+  : ExecutionEngine(M), TD(M), NumExecutedInsts(0) {
       
   memset(&ExitValue.Untyped, 0, sizeof(ExitValue.Untyped));
   setDataLayout(&TD);
@@ -59,6 +60,7 @@ Interpreter::Interpreter(Module *M)
 
 Interpreter::~Interpreter() {
   delete IL;
+  DeleteContainerSeconds(FunctionInfos);
 }
 
 void Interpreter::runAtExitHandlers () {
@@ -18,6 +18,7 @@
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/DataLayout.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/CallSite.h"
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -26,7 +27,6 @@
 namespace llvm {
 
 class IntrinsicLowering;
-struct FunctionInfo;
 template<typename T> class generic_gep_type_iterator;
 class ConstantExpr;
 typedef generic_gep_type_iterator<User::const_op_iterator> gep_type_iterator;
@@ -64,6 +64,61 @@ public:
 
 typedef std::vector<GenericValue> ValuePlaneTy;
 
+// FunctionInfo - Numbering of the values computed by a function.  The first
+// time a function is called, its arguments and instructions are assigned
+// dense slots in the value plane of its stack frames, and every instruction
+// is decoded into the slots of its result and operands.  Instruction
+// operands are then read straight out of the plane without looking the
+// operand up.  Constant operands whose value does not depend on the address
+// of a global are evaluated once and kept with the numbering.  Lowering an
+// intrinsic call changes the function's body; it is decoded again then,
+// keeping the slots already assigned.
+//
+struct FunctionInfo {
+  struct InstInfo {
+    const Instruction *Inst;
+    unsigned Slot;            // Slot of the result, or NoSlot.
+    unsigned FirstOperand;    // Index of operand 0 in OperandSlots.
+  };
+
+  enum {
+    NoSlot = ~0U,
+    ConstantFlag = 1U << 31   // Marks an index into ConstantValues.
+  };
+
+  /// Slots - The slot of each argument and non-void instruction.
+  DenseMap<const Value *, unsigned> Slots;
+  unsigned NumSlots;
+
+  /// Insts - The instructions of the function in layout order.
+  std::vector<InstInfo> Insts;
+
+  /// OperandSlots - For each operand of each instruction, the slot holding
+  /// its value, the index of its value in ConstantValues with ConstantFlag
+  /// set, or NoSlot for operands that have to be evaluated on every use.
+  std::vector<unsigned> OperandSlots;
+
+  /// Constants - The address independent constant operands of the function.
+  /// ConstantValues holds the values of those the interpreter has evaluated.
+  std::vector<const Constant *> Constants;
+  std::vector<GenericValue> ConstantValues;
+  DenseMap<const Constant *, unsigned> ConstantIndices;
+
+  /// BlockStarts - The index in Insts of the first instruction of each block.
+  DenseMap<const BasicBlock *, unsigned> BlockStarts;
+
+  FunctionInfo() : NumSlots(0) {}
+
+  /// decode - Number any new values of F and rebuild the instruction table.
+  void decode(const Function *F);
+
+  unsigned getSlot(const Value *V) const {
+    DenseMap<const Value *, unsigned>::const_iterator I = Slots.find(V);
+    assert(I != Slots.end() && "Value is not computed by this function!");
+    return I->second;
+  }
+};
+
 // ExecutionContext struct - This struct represents one stack frame currently
 // executing.
 //
@@ -71,11 +126,39 @@ struct ExecutionContext {
   Function             *CurFunction;// The currently executing function
   BasicBlock           *CurBB;      // The currently executing BB
   BasicBlock::iterator  CurInst;    // The next instruction to execute
-  std::map<Value *, GenericValue> Values; // LLVM values used in this invocation
+  unsigned              CurInstNo;  // The index of CurInst in FuncInfo->Insts
+  FunctionInfo         *FuncInfo;   // Slot numbering of CurFunction
+  ValuePlaneTy          Values;     // LLVM values used in this invocation
   std::vector<GenericValue>  VarArgs; // Values passed through an ellipsis
   CallSite             Caller;     // Holds the call that called subframes.
                                    // NULL if main func or debugger invoked fn
   AllocaHolderHandle    Allocas;    // Track memory allocated by alloca
+
+  ExecutionContext() : CurFunction(0), CurBB(0), CurInstNo(0), FuncInfo(0) {}
+
+  /// findOperand - Return the decoded slot of V if it is an operand of the
+  /// instruction being executed, or NoSlot.
+  unsigned findOperand(const Value *V) const {
+    if (CurInstNo == 0)
+      return FunctionInfo::NoSlot;
+    const FunctionInfo::InstInfo &II = FuncInfo->Insts[CurInstNo - 1];
+    for (unsigned i = 0, e = II.Inst->getNumOperands(); i != e; ++i)
+      if (II.Inst->getOperand(i) == V)
+        return FuncInfo->OperandSlots[II.FirstOperand + i];
+    return FunctionInfo::NoSlot;
+  }
+
+  /// getValue - Return the value plane entry for V, which is computed by
+  /// CurFunction.  Operands and the result of the instruction being executed
+  /// are found through its decoded slots; anything else is looked up.
+  GenericValue &getValue(const Value *V) {
+    if (CurInstNo != 0 && V == FuncInfo->Insts[CurInstNo - 1].Inst)
+      return Values[FuncInfo->Insts[CurInstNo - 1].Slot];
+    unsigned Slot = findOperand(V);
+    if (Slot == FunctionInfo::NoSlot)
+      Slot = FuncInfo->getSlot(V);
+    return Values[Slot];
+  }
 };
 
 // Interpreter - This class represents the entirety of the interpreter.
@@ -93,6 +176,15 @@ class Interpreter : public ExecutionEngine, public InstVisitor<Interpreter> {
   // registered with the atexit() library function.
   std::vector<Function*> AtExitHandlers;
 
+  // NumExecutedInsts - Instructions executed since the statistics were last
+  // updated.  Statistics are updated atomically, which is too expensive to do
+  // for every instruction.
+  unsigned NumExecutedInsts;
+
+  // FunctionInfos - The value numbering of each function that has been
+  // called, created lazily by getFunctionInfo.
+  DenseMap<const Function*, FunctionInfo*> FunctionInfos;
+
 public:
   explicit Interpreter(Module *M);
   ~Interpreter();
@@ -210,6 +302,9 @@ private:  // Helper functions
 
   void initializeExecutionEngine() { }
   void initializeExternalFunctions();
+  void flushStatistics();
+  FunctionInfo *getFunctionInfo(const Function *F);
+  void decodeFunction(FunctionInfo *FI, const Function *F);
   GenericValue getConstantExprValue(ConstantExpr *CE, ExecutionContext &SF);
   GenericValue getOperandValue(Value *V, ExecutionContext &SF);
   GenericValue executeTruncInst(Value *SrcVal, Type *DstTy,
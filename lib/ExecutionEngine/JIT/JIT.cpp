@@ -12,6 +12,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "jit"
 #include "JIT.h"
 #include "llvm/Constants.h"
 #include "llvm/DerivedTypes.h"
@@ -19,6 +20,8 @@
 #include "llvm/GlobalVariable.h"
 #include "llvm/Instructions.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/JITCodeEmitter.h"
 #include "llvm/CodeGen/MachineCodeInfo.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
@@ -27,6 +30,7 @@
 #include "llvm/DataLayout.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetJITInfo.h"
+#include "llvm/Support/Debug.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -36,6 +40,8 @@
 
 using namespace llvm;
 
+STATISTIC(NumTierUps, "Number of functions recompiled by tiered compilation");
+
 #ifdef __APPLE__
 // Apple gcc defaults to -fuse-cxa-atexit (i.e. calls __cxa_atexit instead
 // of atexit). It passes the address of linker generated symbol __dso_handle
@@ -323,6 +329,7 @@ JIT::~JIT() {
   // Cleanup.
   AllJits->Remove(this);
   delete jitstate;
+  DeleteContainerSeconds(TierUpInfos);
   delete JCE;
   // JMM is a ownership of JCE, so we no need delete JMM here.
   delete &TM;
@@ -641,19 +648,102 @@ void JIT::runJITOnFunctionUnlocked(Function *F, const MutexGuard &locked) {
 }
 
 void JIT::jitTheFunction(Function *F, const MutexGuard &locked) {
+  // With tiered compilation, functions are first compiled with the fast
+  // instruction selector and a call to TierUpCallback on entry.  The call is
+  // only added for the duration of code generation.
+  CallInst *TierUpCall = 0;
+  bool SavedEnableFastISel = TM.Options.EnableFastISel;
+  if (getTierUpThreshold()) {
+    TierUpInfo *&Info = TierUpInfos[F];
+    if (!Info)
+      Info = new TierUpInfo(this, F);
+    if (!Info->Optimized) {
+      LLVMContext &Ctx = F->getContext();
+      Type *IntPtrTy = TM.getDataLayout()->getIntPtrType(Ctx);
+      Type *Int8PtrTy = Type::getInt8PtrTy(Ctx);
+      FunctionType *CallbackTy =
+        FunctionType::get(Type::getVoidTy(Ctx), Int8PtrTy, false);
+      Constant *Callback = ConstantExpr::getIntToPtr(
+        ConstantInt::get(IntPtrTy, (uintptr_t)&TierUpCallback),
+        PointerType::getUnqual(CallbackTy));
+      Constant *Arg = ConstantExpr::getIntToPtr(
+        ConstantInt::get(IntPtrTy, (uintptr_t)Info), Int8PtrTy);
+      Info->Calls = 0;
+      TierUpCall = CallInst::Create(Callback, Arg, "",
+                                    F->getEntryBlock().getFirstInsertionPt());
+      TM.Options.EnableFastISel = true;
+    }
+  }
+
   isAlreadyCodeGenerating = true;
   jitstate->getPM(locked).run(*F);
   isAlreadyCodeGenerating = false;
 
+  if (TierUpCall) {
+    Constant *Callback = cast<Constant>(TierUpCall->getCalledValue());
+    Constant *Arg = cast<Constant>(TierUpCall->getArgOperand(0));
+    TierUpCall->eraseFromParent();
+    // The constants are uniqued in the context and would otherwise live as
+    // long as it does.
+    if (Callback->use_empty())
+      Callback->destroyConstant();
+    if (Arg->use_empty())
+      Arg->destroyConstant();
+    TM.Options.EnableFastISel = SavedEnableFastISel;
+  }
+
   // clear basic block addresses after this function is done
   getBasicBlockAddressMap(locked).clear();
 }
 
+void JIT::TierUpCallback(TierUpInfo *Info) {
+  JIT *TheJIT = Info->TheJIT;
+  if (!Info->Optimized && ++Info->Calls >= TheJIT->getTierUpThreshold()) {
+    // Relinking patches the entry of the old code, which is where this call
+    // returns to, so the function waits for a safe point: the callback of
+    // another function or the next getPointerToFunction.
+    MutexGuard locked(TheJIT->lock);
+    Info->Optimized = true;
+    TheJIT->PendingTierUps.push_back(Info);
+  }
+
+  if (!TheJIT->PendingTierUps.empty())
+    TheJIT->runPendingTierUps(Info);
+}
+
+void JIT::runPendingTierUps(const TierUpInfo *Running) {
+  MutexGuard locked(lock);
+
+  // Code generation asks for the addresses of callees; a recompile cannot
+  // start from there.
+  if (isAlreadyCodeGenerating)
+    return;
+
+  SmallVector<TierUpInfo*, 4> Ready;
+  unsigned Kept = 0;
+  for (unsigned i = 0, e = PendingTierUps.size(); i != e; ++i)
+    if (PendingTierUps[i] == Running)
+      PendingTierUps[Kept++] = PendingTierUps[i];
+    else
+      Ready.push_back(PendingTierUps[i]);
+  PendingTierUps.resize(Kept);
+
+  for (unsigned i = 0, e = Ready.size(); i != e; ++i) {
+    DEBUG(dbgs() << "JIT: recompiling '" << Ready[i]->F->getName()
+                 << "' after " << Ready[i]->Calls << " calls\n");
+    ++NumTierUps;
+    recompileAndRelinkFunction(Ready[i]->F);
+  }
+}
+
 /// getPointerToFunction - This method is used to get the address of the
 /// specified function, compiling it if necessary.
 ///
 void *JIT::getPointerToFunction(Function *F) {
 
+  if (!PendingTierUps.empty())
+    runPendingTierUps(0);
+
   if (void *Addr = getPointerToGlobalIfAvailable(F))
     return Addr;   // Check if function already code gen'd
 
@@ -16,6 +16,8 @@
 
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/PassManager.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/ValueHandle.h"
 
 namespace llvm {
@@ -77,6 +79,24 @@ class JIT : public ExecutionEngine {
   /// taken.
   BasicBlockAddressMapTy BasicBlockAddressMap;
 
+  /// TierUpInfo - The call count of a function compiled by the first tier of
+  /// tiered compilation.  Its code passes a pointer to this to TierUpCallback
+  /// on every call.  Optimized is set once the function has been queued for
+  /// recompilation.  The info lives until freeMachineCodeForFunction.
+  struct TierUpInfo {
+    JIT *TheJIT;
+    Function *F;
+    unsigned Calls;
+    bool Optimized;
+    TierUpInfo(JIT *TheJIT, Function *F)
+      : TheJIT(TheJIT), F(F), Calls(0), Optimized(false) {}
+  };
+  DenseMap<const Function*, TierUpInfo*> TierUpInfos;
+
+  /// PendingTierUps - Functions that reached the tier-up threshold and wait
+  /// for a safe point to be recompiled and relinked.
+  SmallVector<TierUpInfo*, 4> PendingTierUps;
+
 
   JIT(Module *M, TargetMachine &tm, TargetJITInfo &tji,
       JITMemoryManager *JMM, bool AllocateGVsWithCode);
@@ -214,6 +234,15 @@ private:
   void updateFunctionStub(Function *F);
   void jitTheFunction(Function *F, const MutexGuard &locked);
 
+  /// TierUpCallback - Invoked on every call to a function compiled by the
+  /// first tier.  Once a function reaches the tier-up threshold it is queued,
+  /// and queued functions are recompiled at the next safe point.
+  static void TierUpCallback(TierUpInfo *Info);
+
+  /// runPendingTierUps - Recompile and relink the queued functions, except
+  /// Running, whose entry is executing the caller.
+  void runPendingTierUps(const TierUpInfo *Running);
+
 protected:
 
   /// getMemoryforGV - Allocate memory for a global variable.
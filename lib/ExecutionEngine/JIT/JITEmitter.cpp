@@ -1286,6 +1286,16 @@ void JIT::freeMachineCodeForFunction(Function *F) {
   // retranslated next time it is used.
   updateGlobalMapping(F, 0);
 
+  // Forget its tier-up state, which only the code freed below refers to.
+  DenseMap<const Function*, TierUpInfo*>::iterator I = TierUpInfos.find(F);
+  if (I != TierUpInfos.end()) {
+    PendingTierUps.erase(std::remove(PendingTierUps.begin(),
+                                     PendingTierUps.end(), I->second),
+                         PendingTierUps.end());
+    delete I->second;
+    TierUpInfos.erase(I);
+  }
+
   // Free the actual memory for the function body and related stuff.
   static_cast<JITEmitter*>(JCE)->deallocateMemForFunction(F);
 }
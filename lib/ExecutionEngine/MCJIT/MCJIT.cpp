@@ -7,24 +7,37 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "mcjit"
 #include "MCJIT.h"
 #include "llvm/DerivedTypes.h"
 #include "llvm/Function.h"
+#include "llvm/Module.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/JITMemoryManager.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/ExecutionEngine/ObjectBuffer.h"
 #include "llvm/ExecutionEngine/ObjectImage.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/MC/MCAsmInfo.h"
+#include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/InstIterator.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/MutexGuard.h"
 #include "llvm/DataLayout.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 
 using namespace llvm;
 
+STATISTIC(NumObjectCacheHits, "Number of objects loaded from the object cache");
+STATISTIC(NumObjectCacheMisses,
+          "Number of objects compiled because of an object cache miss");
+STATISTIC(NumLazyUnits, "Number of units compiled lazily");
+STATISTIC(NumLazyFunctions, "Number of functions compiled in lazy units");
+
 namespace {
 
 static struct RegisterJIT {
@@ -51,17 +64,52 @@ ExecutionEngine *MCJIT::createJIT(Module *M,
 
 MCJIT::MCJIT(Module *m, TargetMachine *tm, RTDyldMemoryManager *MM,
              bool AllocateGVsWithCode)
-  : ExecutionEngine(m), TM(tm), Ctx(0), MemMgr(MM), Dyld(MM),
-    isCompiled(false), M(m)  {
+  : ExecutionEngine(m), TM(tm), Ctx(0), MemMgr(MM), Dyld(MM), ObjCache(0),
+    isCompiled(false), M(m), CompilingInUnits(false) {
 
   setDataLayout(TM->getDataLayout());
 }
 
 MCJIT::~MCJIT() {
-  if (LoadedObject)
-    NotifyFreeingObject(*LoadedObject.get());
+  for (unsigned i = 0, e = LoadedObjects.size(); i != e; ++i)
+    NotifyFreeingObject(*LoadedObjects[i]);
   delete MemMgr;
   delete TM;
+  for (unsigned i = 0, e = LoadedObjects.size(); i != e; ++i)
+    delete LoadedObjects[i];
+}
+
+void MCJIT::setObjectCache(ObjectCache* NewCache) {
+  ObjCache = NewCache;
+}
+
+ObjectBufferStream *MCJIT::generateCodeForModule(Module *m) {
+  PassManager PM;
+
+  PM.add(new DataLayout(*TM->getDataLayout()));
+
+  // The RuntimeDyld will take ownership of this shortly
+  OwningPtr<ObjectBufferStream> CompiledObject(new ObjectBufferStream());
+
+  // Turn the machine code intermediate representation into bytes in memory
+  // that may be executed.
+  if (TM->addPassesToEmitMC(PM, Ctx, CompiledObject->getOStream(), false)) {
+    report_fatal_error("Target does not support MC emission!");
+  }
+
+  // Initialize passes.
+  PM.run(*m);
+  // Flush the output buffer to get the generated code into memory
+  CompiledObject->flush();
+
+  // If we have an object cache, tell it about the new object.
+  // Note that we're using the compiled image, not the loaded image (as below).
+  if (ObjCache) {
+    OwningPtr<MemoryBuffer> MB(CompiledObject->getMemBuffer());
+    ObjCache->notifyObjectCompiled(m, MB.get());
+  }
+
+  return CompiledObject.take();
 }
 
 void MCJIT::emitObject(Module *m) {
@@ -80,29 +128,216 @@ void MCJIT::emitObject(Module *m) {
   if (isCompiled)
     return;
 
-  PassManager PM;
+  loadObjectForModule(m);
 
-  PM.add(new DataLayout(*TM->getDataLayout()));
+  // FIXME: Add support for per-module compilation state
+  isCompiled = true;
+}
 
-  // The RuntimeDyld will take ownership of this shortly
-  OwningPtr<ObjectBufferStream> Buffer(new ObjectBufferStream());
+/// collectReferencedValues - Add the functions that C refers to, directly or
+/// through constant expressions and aggregates, to Worklist, and every global
+/// value it refers to to Globals.
+static void collectReferencedValues(Constant *C,
+                                    SmallPtrSet<Constant*, 32> &Visited,
+                                    SmallVectorImpl<Function*> &Worklist,
+                                    SmallVectorImpl<GlobalValue*> &Globals) {
+  if (!Visited.insert(C))
+    return;
+  // Global variables are all defined by the first unit, their initializers
+  // are walked when it is built.
+  if (GlobalValue *GV = dyn_cast<GlobalValue>(C)) {
+    Globals.push_back(GV);
+    if (Function *F = dyn_cast<Function>(GV))
+      Worklist.push_back(F);
+    return;
+  }
+  for (User::op_iterator I = C->op_begin(), E = C->op_end(); I != E; ++I)
+    if (Constant *Op = dyn_cast<Constant>(*I))
+      collectReferencedValues(Op, Visited, Worklist, Globals);
+}
 
-  // Turn the machine code intermediate representation into bytes in memory
-  // that may be executed.
-  if (TM->addPassesToEmitMC(PM, Ctx, Buffer->getOStream(), false)) {
-    report_fatal_error("Target does not support MC emission!");
+/// exportSymbol - Give GV a symbol that other units can link against.
+static void exportSymbol(GlobalValue *GV) {
+  if (!GV->hasLocalLinkage())
+    return;
+  GV->setLinkage(GlobalValue::ExternalLinkage);
+  GV->setVisibility(GlobalValue::DefaultVisibility);
+}
+
+std::string MCJIT::getSymbolName(const GlobalValue *GV) {
+  if (GV->hasName())
+    return GV->getName();
+
+  MutexGuard locked(lock);
+  unsigned &ID = UnnamedSymbols[GV];
+  if (!ID)
+    ID = UnnamedSymbols.size();
+  return "__mcjit_unnamed." + utostr(ID);
+}
+
+bool MCJIT::canCompileInUnits() const {
+  return isCompilingLazily() && isUnitCompilationEnabled() &&
+         M->alias_empty() && !M->getNamedMetadata("llvm.dbg.cu");
+}
+
+void MCJIT::emitFunctionUnit(Function *F) {
+  MutexGuard locked(lock);
+
+  if (EmittedFunctions.count(F))
+    return;
+
+  bool FirstUnit = !isCompiled;
+  SmallVector<Function*, 16> Worklist;
+  SmallVector<GlobalValue*, 32> Referenced;
+  SmallPtrSet<Constant*, 32> Visited;
+  Worklist.push_back(F);
+
+  if (FirstUnit)
+    for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+         I != E; ++I)
+      if (I->hasInitializer())
+        collectReferencedValues(I->getInitializer(), Visited, Worklist,
+                                Referenced);
+
+  SmallVector<Function*, 16> UnitFunctions;
+  SmallPtrSet<const Function*, 16> InUnit;
+  while (!Worklist.empty()) {
+    Function *Fn = Worklist.pop_back_val();
+    if (EmittedFunctions.count(Fn) || InUnit.count(Fn))
+      continue;
+
+    std::string ErrorMsg;
+    if (Fn->Materialize(&ErrorMsg))
+      report_fatal_error("Error reading function '" + Fn->getName() +
+                         "' from bitcode file: " + ErrorMsg);
+    if (Fn->isDeclaration() || Fn->hasAvailableExternallyLinkage())
+      continue;
+
+    InUnit.insert(Fn);
+    UnitFunctions.push_back(Fn);
+    for (inst_iterator I = inst_begin(Fn), E = inst_end(Fn); I != E; ++I)
+      for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE;
+           ++OI)
+        if (Constant *C = dyn_cast<Constant>(*OI))
+          collectReferencedValues(C, Visited, Worklist, Referenced);
   }
 
-  // Initialize passes.
-  PM.run(*m);
-  // Flush the output buffer to get the generated code into memory
-  Buffer->flush();
+  // Nothing to do if F turned out to be a declaration.
+  if (UnitFunctions.empty())
+    return;
+
+  // Build the unit in a new module that defines the functions of this unit,
+  // and in the first unit all global variables, and declares the rest of the
+  // symbols they refer to.  Symbols defined by earlier units resolve through
+  // the dynamic linker's global symbol table.  Unnamed values get a name in
+  // the units only; M itself is left alone.
+  OwningPtr<Module> Unit(new Module(M->getModuleIdentifier() + "#" +
+                                    getSymbolName(F), M->getContext()));
+  Unit->setDataLayout(M->getDataLayout());
+  Unit->setTargetTriple(M->getTargetTriple());
+  // Module level asm defines its symbols once, in the first unit.
+  if (FirstUnit)
+    Unit->setModuleInlineAsm(M->getModuleInlineAsm());
+
+  ValueToValueMapTy VMap;
+  if (FirstUnit)
+    for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+         I != E; ++I) {
+      GlobalVariable *NewGV =
+        new GlobalVariable(*Unit, I->getType()->getElementType(),
+                           I->isConstant(), I->getLinkage(), 0,
+                           getSymbolName(I), 0, I->getThreadLocalMode(),
+                           I->getType()->getAddressSpace());
+      NewGV->copyAttributesFrom(I);
+      exportSymbol(NewGV);
+      VMap[I] = NewGV;
+    }
+
+  for (unsigned i = 0, e = UnitFunctions.size(); i != e; ++i) {
+    Function *Fn = UnitFunctions[i];
+    Function *NewF = Function::Create(Fn->getFunctionType(), Fn->getLinkage(),
+                                      getSymbolName(Fn), Unit.get());
+    NewF->copyAttributesFrom(Fn);
+    exportSymbol(NewF);
+    VMap[Fn] = NewF;
+  }
+
+  for (unsigned i = 0, e = Referenced.size(); i != e; ++i) {
+    GlobalValue *GV = Referenced[i];
+    if (VMap.count(GV))
+      continue;
+    GlobalValue::LinkageTypes Linkage = GV->hasExternalWeakLinkage() ?
+      GlobalValue::ExternalWeakLinkage : GlobalValue::ExternalLinkage;
+    GlobalValue *Decl;
+    if (Function *Fn = dyn_cast<Function>(GV)) {
+      Decl = Function::Create(Fn->getFunctionType(), Linkage,
+                              getSymbolName(Fn), Unit.get());
+    } else {
+      GlobalVariable *GVar = cast<GlobalVariable>(GV);
+      Decl = new GlobalVariable(*Unit, GVar->getType()->getElementType(),
+                                GVar->isConstant(), Linkage, 0,
+                                getSymbolName(GVar), 0,
+                                GVar->getThreadLocalMode(),
+                                GVar->getType()->getAddressSpace());
+    }
+    Decl->copyAttributesFrom(GV);
+    Decl->setVisibility(GlobalValue::DefaultVisibility);
+    VMap[GV] = Decl;
+  }
+
+  if (FirstUnit)
+    for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+         I != E; ++I)
+      if (I->hasInitializer())
+        cast<GlobalVariable>(VMap[I])->setInitializer(
+          MapValue(I->getInitializer(), VMap));
+
+  for (unsigned i = 0, e = UnitFunctions.size(); i != e; ++i) {
+    Function *Fn = UnitFunctions[i];
+    Function *NewF = cast<Function>(VMap[Fn]);
+    Function::arg_iterator DestI = NewF->arg_begin();
+    for (Function::arg_iterator I = Fn->arg_begin(), E = Fn->arg_end(); I != E;
+         ++I, ++DestI) {
+      DestI->setName(I->getName());
+      VMap[I] = DestI;
+    }
+
+    SmallVector<ReturnInst*, 8> Returns;
+    CloneFunctionInto(NewF, Fn, VMap, /*ModuleLevelChanges=*/true, Returns);
+    EmittedFunctions.insert(Fn);
+  }
+
+  DEBUG(dbgs() << "MCJIT: compiling unit for '" << getSymbolName(F)
+               << "' with " << UnitFunctions.size() << " functions\n");
+  ++NumLazyUnits;
+  NumLazyFunctions += UnitFunctions.size();
+
+  loadObjectForModule(Unit.get());
+  isCompiled = true;
+}
+
+void MCJIT::loadObjectForModule(Module *m) {
+  OwningPtr<ObjectBuffer> ObjectToLoad;
+  // Try to load the pre-compiled object from cache if possible
+  if (ObjCache) {
+    if (MemoryBuffer *PreCompiledObject = ObjCache->getObject(m)) {
+      ++NumObjectCacheHits;
+      ObjectToLoad.reset(new ObjectBuffer(PreCompiledObject));
+    } else {
+      ++NumObjectCacheMisses;
+    }
+  }
+
+  // If the cache did not contain a suitable object, compile the object
+  if (!ObjectToLoad)
+    ObjectToLoad.reset(generateCodeForModule(m));
 
   // Load the object into the dynamic linker.
   // handing off ownership of the buffer
-  LoadedObject.reset(Dyld.loadObject(Buffer.take()));
+  ObjectImage *LoadedObject = Dyld.loadObject(ObjectToLoad.take());
   if (!LoadedObject)
     report_fatal_error(Dyld.getErrorString());
+  LoadedObjects.push_back(LoadedObject);
 
   // Resolve any relocations.
   Dyld.resolveRelocations();
@@ -111,16 +346,17 @@ void MCJIT::emitObject(Module *m) {
   LoadedObject->registerWithDebugger();
 
   NotifyObjectEmitted(*LoadedObject);
-
-  // FIXME: Add support for per-module compilation state
-  isCompiled = true;
 }
 
 // FIXME: Add a parameter to identify which object is being finalized when
 // MCJIT supports multiple modules.
 void MCJIT::finalizeObject() {
-  // If the module hasn't been compiled, just do that.
+  // If the module hasn't been compiled, just do that.  When compiling in
+  // units there is nothing to finalize until the first unit has been emitted.
   if (!isCompiled) {
+    if (canCompileInUnits())
+      return;
+
     // If the call to Dyld.resolveRelocations() is removed from emitObject()
     // we'll need to do that here.
     emitObject(M);
@@ -143,7 +379,12 @@ void *MCJIT::getPointerToFunction(Function *F) {
 
   // FIXME: Add support for per-module compilation state
   if (!isCompiled)
+    CompilingInUnits = canCompileInUnits();
+
+  if (!CompilingInUnits)
     emitObject(M);
+  else
+    emitFunctionUnit(F);
 
   if (F->isDeclaration() || F->hasAvailableExternallyLinkage()) {
     bool AbortOnFailure = !F->hasExternalWeakLinkage();
@@ -157,7 +398,8 @@ void *MCJIT::getPointerToFunction(Function *F) {
   //
   // This is the accessor for the target address, so make sure to check the
   // load address of the symbol, not the local address.
-  StringRef BaseName = F->getName();
+  std::string Name = CompilingInUnits ? getSymbolName(F) : F->getName().str();
+  StringRef BaseName = Name;
   if (BaseName[0] == '\1')
     return (void*)Dyld.getSymbolLoadAddress(BaseName.substr(1));
   return (void*)Dyld.getSymbolLoadAddress((TM->getMCAsmInfo()->getGlobalPrefix()
@@ -275,7 +517,7 @@ GenericValue MCJIT::runFunction(Function *F,
 void *MCJIT::getPointerToNamedFunction(const std::string &Name,
                                        bool AbortOnFailure) {
   // FIXME: Add support for per-module compilation state
-  if (!isCompiled)
+  if (!isCompiled && !canCompileInUnits())
     emitObject(M);
 
   if (!isSymbolSearchingDisabled() && MemMgr) {
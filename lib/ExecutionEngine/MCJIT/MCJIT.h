@@ -11,12 +11,16 @@
 #define LLVM_LIB_EXECUTIONENGINE_MCJIT_H
 
 #include "llvm/PassManager.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
 
 namespace llvm {
 
+class ObjectBufferStream;
 class ObjectImage;
 
 // FIXME: This makes all kinds of horrible assumptions for the time being,
@@ -33,10 +37,26 @@ class MCJIT : public ExecutionEngine {
   RuntimeDyld Dyld;
   SmallVector<JITEventListener*, 2> EventListeners;
 
+  // The optional ObjectCache to consult before generating code.
+  ObjectCache *ObjCache;
+
   // FIXME: Add support for multiple modules
   bool isCompiled;
   Module *M;
-  OwningPtr<ObjectImage> LoadedObject;
+
+  // The objects loaded into Dyld.  Unless the module is compiled in units
+  // there is exactly one.
+  SmallVector<ObjectImage*, 1> LoadedObjects;
+
+  // When unit compilation is enabled, the module is compiled one unit at a
+  // time: each unit holds a requested function and every function reachable
+  // from it that has not been emitted yet.  CompilingInUnits is fixed when
+  // the first object is loaded.
+  bool CompilingInUnits;
+  SmallPtrSet<const Function*, 16> EmittedFunctions;
+
+  // The numbers of the names given to unnamed values in the units.
+  DenseMap<const GlobalValue*, unsigned> UnnamedSymbols;
 
 public:
   ~MCJIT();
@@ -44,6 +64,9 @@ public:
   /// @name ExecutionEngine interface implementation
   /// @{
 
+  /// Sets the object manager that MCJIT should use to avoid compilation.
+  virtual void setObjectCache(ObjectCache *manager);
+
   virtual void finalizeObject();
 
   virtual void *getPointerToBasicBlock(BasicBlock *BB);
@@ -104,6 +127,30 @@ protected:
   /// the future.
   void emitObject(Module *M);
 
+  /// emitFunctionUnit - Generate and load an object for F and for all of the
+  /// not yet emitted functions reachable from it.  The first unit also
+  /// defines all of the module's global variables.
+  void emitFunctionUnit(Function *F);
+
+  /// canCompileInUnits - Return true if the module is to be compiled in
+  /// units: unit and lazy compilation are both enabled, and the module has
+  /// no aliases or debug info.  Otherwise it is compiled as a whole.
+  bool canCompileInUnits() const;
+
+  /// getSymbolName - Return the name GV has in the units: its own name, or a
+  /// name made up for it if it has none.
+  std::string getSymbolName(const GlobalValue *GV);
+
+  /// loadObjectForModule - Get an object for M from the object cache or by
+  /// generating code, load it into the dynamic linker and resolve
+  /// relocations.
+  void loadObjectForModule(Module *M);
+
+  /// generateCodeForModule - Run code generation for M and return the
+  /// resulting object, handing a copy of it to the object cache if one is
+  /// set.
+  ObjectBufferStream *generateCodeForModule(Module *M);
+
   void NotifyObjectEmitted(const ObjectImage& Obj);
   void NotifyFreeingObject(const ObjectImage& Obj);
 };
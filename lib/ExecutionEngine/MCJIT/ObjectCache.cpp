@@ -0,0 +1,101 @@
+//===-- ObjectCache.cpp - Caches of MCJIT generated objects ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the ObjectCache anchor and FileObjectCache.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "mcjit"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PathV2.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include "llvm/Target/TargetMachine.h"
+#include <cstring>
+
+using namespace llvm;
+
+void ObjectCache::anchor() {}
+
+FileObjectCache::FileObjectCache(StringRef Dir, const TargetMachine &TM)
+  : CacheDir(Dir), LastModule(0) {
+  raw_string_ostream OS(Configuration);
+  OS << TM.getTargetTriple() << '|' << TM.getTargetCPU() << '|'
+     << TM.getTargetFeatureString() << '|' << TM.getOptLevel() << '|'
+     << TM.getRelocationModel() << '|' << TM.getCodeModel();
+  OS.flush();
+}
+
+std::string FileObjectCache::getCacheFilePath(const Module *M) const {
+  SmallString<4096> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(M, OS);
+  }
+
+  uint64_t Hash = HashString64(Configuration);
+  Hash = HashString64(M->getTargetTriple(), Hash);
+  Hash = HashString64(Bitcode.str(), Hash);
+
+  SmallString<128> Path(CacheDir);
+  sys::path::append(Path, utohexstr(Hash) + "-" + utostr(Bitcode.size()) +
+                    ".o");
+  return Path.str();
+}
+
+MemoryBuffer *FileObjectCache::getObject(const Module *M) {
+  std::string Path = getCacheFilePath(M);
+  OwningPtr<MemoryBuffer> File;
+  if (MemoryBuffer::getFile(Path, File)) {
+    // MCJIT hands the object back after code generation, which may have
+    // changed the IR; remember the key the object was looked up under.
+    LastModule = M;
+    LastPath = Path;
+    return 0;
+  }
+
+  DEBUG(dbgs() << "Found cached object for '" << M->getModuleIdentifier()
+               << "' in " << Path << "\n");
+
+  // The runtime linker patches the object while loading it, so hand out a
+  // private copy rather than the read-only mapping of the file.
+  return MemoryBuffer::getMemBufferCopy(File->getBuffer(), Path);
+}
+
+void FileObjectCache::notifyObjectCompiled(const Module *M,
+                                           const MemoryBuffer *Obj) {
+  bool Existed;
+  if (sys::fs::create_directories(CacheDir, Existed))
+    return;
+
+  // FileOutputBuffer writes to a temporary file and renames it over Path on
+  // commit, so readers either see the complete object or nothing.
+  std::string Path;
+  if (M == LastModule)
+    Path.swap(LastPath);
+  else
+    Path = getCacheFilePath(M);
+  LastModule = 0;
+  OwningPtr<FileOutputBuffer> Out;
+  if (FileOutputBuffer::create(Path, Obj->getBufferSize(), Out))
+    return;
+  memcpy(Out->getBufferStart(), Obj->getBufferStart(), Obj->getBufferSize());
+  if (!Out->commit())
+    DEBUG(dbgs() << "Cached object for '" << M->getModuleIdentifier()
+                 << "' in " << Path << "\n");
+}
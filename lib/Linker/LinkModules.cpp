@@ -11,6 +11,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "linker"
 #include "llvm/Linker.h"
 #include "llvm/Constants.h"
 #include "llvm/DerivedTypes.h"
@@ -18,9 +19,12 @@
 #include "llvm/Module.h"
 #include "llvm/TypeFinder.h"
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
@@ -30,6 +34,9 @@
 #include <cctype>
 using namespace llvm;
 
+STATISTIC(NumMovedBodies, "Number of function bodies moved from the source");
+STATISTIC(NumClonedBodies, "Number of function bodies cloned from the source");
+
 //===----------------------------------------------------------------------===//
 // TypeMap implementation.
 //===----------------------------------------------------------------------===//
@@ -64,6 +71,10 @@ public:
   /// module from a type definition in the source module.
   void linkDefinedTypeBodies();
   
+  /// isMapped - Return true if a mapping for the specified source type has
+  /// been established.
+  bool isMapped(Type *SrcTy) const { return MappedTypes.lookup(SrcTy) != 0; }
+
   /// get - Return the mapped type to use for the specified input type from the
   /// source module.
   Type *get(Type *SrcTy);
@@ -564,6 +575,52 @@ bool ModuleLinker::getLinkageResult(GlobalValue *Dest, const GlobalValue *Src,
   return false;
 }
 
+/// getTypeNameRoot - Return the name of a struct type without the ".N"
+/// suffixes the LLVMContext appends to make names unique.
+static StringRef getTypeNameRoot(StructType *STy) {
+  StringRef Name = STy->getName();
+  for (;;) {
+    size_t DotPos = Name.rfind('.');
+    if (DotPos == 0 || DotPos == StringRef::npos || DotPos + 1 == Name.size())
+      return Name;
+    StringRef Suffix = Name.substr(DotPos + 1);
+    for (unsigned i = 0, e = Suffix.size(); i != e; ++i)
+      if (!isdigit(Suffix[i]))
+        return Name;
+    Name = Name.substr(0, DotPos);
+  }
+}
+
+/// hashTypeShape - Hash the parts of a type that areTypesIsomorphic compares.
+/// Named struct types nested in Ty only contribute their name root, which
+/// keeps the hash finite for recursive types and independent of which of the
+/// renamed copies of a struct Ty refers to.
+static hash_code hashTypeShape(Type *Ty, bool IsOutermost = true) {
+  if (StructType *STy = dyn_cast<StructType>(Ty))
+    if (!STy->isLiteral() && !IsOutermost)
+      return hash_combine(Ty->getTypeID(), getTypeNameRoot(STy));
+
+  unsigned Extra = 0;
+  if (IntegerType *ITy = dyn_cast<IntegerType>(Ty))
+    Extra = ITy->getBitWidth();
+  else if (PointerType *PTy = dyn_cast<PointerType>(Ty))
+    Extra = PTy->getAddressSpace();
+  else if (FunctionType *FTy = dyn_cast<FunctionType>(Ty))
+    Extra = FTy->isVarArg();
+  else if (StructType *STy = dyn_cast<StructType>(Ty))
+    Extra = STy->isPacked();
+  else if (ArrayType *ATy = dyn_cast<ArrayType>(Ty))
+    Extra = ATy->getNumElements();
+  else if (VectorType *VTy = dyn_cast<VectorType>(Ty))
+    Extra = VTy->getNumElements();
+
+  hash_code Hash = hash_combine(Ty->getTypeID(), Extra,
+                                Ty->getNumContainedTypes());
+  for (unsigned i = 0, e = Ty->getNumContainedTypes(); i != e; ++i)
+    Hash = hash_combine(Hash, hashTypeShape(Ty->getContainedType(i), false));
+  return Hash;
+}
+
 /// computeTypeMapping - Loop over all of the linked values to compute type
 /// mappings.  For example, if we link "extern Foo *x" and "Foo *x = NULL", then
 /// we have two struct types 'Foo' but one got renamed when the module was
@@ -639,6 +696,44 @@ void ModuleLinker::computeTypeMapping() {
         TypeMap.addTypeMapping(DST, ST);
   }
 
+  // After many links both modules may only have renamed copies of a struct,
+  // e.g. "%foo.12" in the destination and "%foo.57" in the source, which the
+  // lookup above cannot pair up.  Bucket the destination structs by name root
+  // and shape so that each remaining source struct is only checked for
+  // isomorphism against the few destination structs that can match it,
+  // rather than left unmapped and duplicated once more.
+  typedef SmallVector<std::pair<hash_code, StructType*>, 2> ShapeBucket;
+  StringMap<ShapeBucket> DstStructsByRoot;
+  for (unsigned i = 0, e = DstStructTypes.size(); i != e; ++i) {
+    StructType *DST = DstStructTypes[i];
+    if (DST->hasName() && !DST->isOpaque() && !SrcStructTypesSet.count(DST))
+      DstStructsByRoot[getTypeNameRoot(DST)].push_back(
+        std::make_pair(hashTypeShape(DST), DST));
+  }
+
+  if (!DstStructsByRoot.empty()) {
+    for (unsigned i = 0, e = SrcStructTypes.size(); i != e; ++i) {
+      StructType *ST = SrcStructTypes[i];
+      if (!ST->hasName() || ST->isOpaque() || TypeMap.isMapped(ST))
+        continue;
+
+      StringMap<ShapeBucket>::iterator Bucket =
+        DstStructsByRoot.find(getTypeNameRoot(ST));
+      if (Bucket == DstStructsByRoot.end())
+        continue;
+
+      hash_code Shape = hashTypeShape(ST);
+      ShapeBucket &Candidates = Bucket->getValue();
+      for (unsigned j = 0, je = Candidates.size(); j != je; ++j) {
+        if (Candidates[j].first != Shape)
+          continue;
+        TypeMap.addTypeMapping(Candidates[j].second, ST);
+        if (TypeMap.isMapped(ST))
+          break;
+      }
+    }
+  }
+
   // Don't bother incorporating aliases, they aren't generally typed well.
   
   // Now that we have discovered all of the type equivalences, get a body for
@@ -936,6 +1031,7 @@ void ModuleLinker::linkFunctionBody(Function *Dst, Function *Src) {
   if (Mode == Linker::DestroySource) {
     // Splice the body of the source function into the dest function.
     Dst->getBasicBlockList().splice(Dst->end(), Src->getBasicBlockList());
+    ++NumMovedBodies;
     
     // At this point, all of the instructions and values of the function are now
     // copied over.  The only problem is that they are still referencing values in
@@ -949,6 +1045,7 @@ void ModuleLinker::linkFunctionBody(Function *Dst, Function *Src) {
     // Clone the body of the function into the dest function.
     SmallVector<ReturnInst*, 8> Returns; // Ignore returns.
     CloneFunctionInto(Dst, Src, ValueMap, false, Returns, "", NULL, &TypeMap);
+    ++NumClonedBodies;
   }
   
   // There is no need to map the arguments anymore.
@@ -1157,6 +1254,10 @@ bool ModuleLinker::run() {
   assert(DstM && "Null destination module");
   assert(SrcM && "Null source module");
 
+  // The named metadata is linked below, make sure it has been read.
+  if (SrcM->MaterializeMetadata(&ErrorMsg))
+    return true;
+
   // Inherit the target data from the source module if the destination module
   // doesn't have one already.
   if (DstM->getDataLayout().empty() && !SrcM->getDataLayout().empty())
@@ -13,13 +13,17 @@
 
 #include "llvm/Object/Archive.h"
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PathV2.h"
 
 using namespace llvm;
 using namespace object;
 
 static const char *Magic = "!<arch>\n";
+static const char *ThinMagic = "!<thin>\n";
 
 namespace {
 struct ArchiveMemberHeader {
@@ -74,11 +78,20 @@ static bool isInternalMember(const ArchiveMemberHeader &amh) {
   return false;
 }
 
+/// Return the number of bytes the member whose header is at Loc occupies in
+/// the archive, not counting padding.  In a thin archive only the symbol and
+/// string tables are stored; the other members are just a header.
+static size_t getMemberSize(const Archive *Parent, const char *Loc) {
+  const ArchiveMemberHeader *Hdr = ToHeader(Loc);
+  if (Parent->isThin() && !isInternalMember(*Hdr))
+    return sizeof(ArchiveMemberHeader);
+  return sizeof(ArchiveMemberHeader) + Hdr->getSize();
+}
+
 void Archive::anchor() { }
 
 Archive::Child Archive::Child::getNext() const {
-  size_t SpaceToSkip = sizeof(ArchiveMemberHeader) +
-    ToHeader(Data.data())->getSize();
+  size_t SpaceToSkip = getMemberSize(Parent, Data.data());
   // If it's odd, add 1 to make it even.
   if (SpaceToSkip & 1)
     ++SpaceToSkip;
@@ -89,10 +102,7 @@ Archive::Child Archive::Child::getNext() const {
   if (NextLoc >= Parent->Data->getBufferEnd())
     return Child(Parent, StringRef(0, 0));
 
-  size_t NextSize = sizeof(ArchiveMemberHeader) +
-    ToHeader(NextLoc)->getSize();
-
-  return Child(Parent, StringRef(NextLoc, NextSize));
+  return Child(Parent, StringRef(NextLoc, getMemberSize(Parent, NextLoc)));
 }
 
 error_code Archive::Child::getName(StringRef &Result) const {
@@ -115,14 +125,20 @@ error_code Archive::Child::getName(StringRef &Result) const {
                        + sizeof(ArchiveMemberHeader)
                        + offset.getZExtValue();
     // Verify it.
-    if (Parent->StringTable == Parent->end_children()
-        || addr < (Parent->StringTable->Data.begin()
-                   + sizeof(ArchiveMemberHeader))
-        || addr > (Parent->StringTable->Data.begin()
-                   + sizeof(ArchiveMemberHeader)
-                   + Parent->StringTable->getSize()))
+    if (Parent->StringTable == Parent->end_children())
       return object_error::parse_failed;
-    Result = addr;
+    const char *end = Parent->StringTable->Data.begin()
+                      + sizeof(ArchiveMemberHeader)
+                      + Parent->StringTable->getSize();
+    if (addr < (Parent->StringTable->Data.begin()
+                + sizeof(ArchiveMemberHeader))
+        || addr > end)
+      return object_error::parse_failed;
+    // GNU string tables end each name with "/\n", COFF ones with a null.
+    Result = StringRef(addr, end - addr);
+    Result = Result.substr(0, Result.find_first_of(StringRef("\n\0", 2)));
+    if (Result.endswith("/"))
+      Result = Result.drop_back();
     return object_error::success;
   } else if (name.startswith("#1/")) {
     APInt name_size;
@@ -153,6 +169,18 @@ uint64_t Archive::Child::getSize() const {
 MemoryBuffer *Archive::Child::getBuffer() const {
   StringRef name;
   if (getName(name)) return NULL;
+  if (Parent->isThin() && !isInternalMember(*ToHeader(Data.data()))) {
+    // The member is stored in the file its name refers to.  Relative names
+    // are relative to the directory containing the archive.
+    SmallString<128> path;
+    if (!sys::path::is_absolute(name))
+      path = sys::path::parent_path(Parent->Data->getBufferIdentifier());
+    sys::path::append(path, name);
+    OwningPtr<MemoryBuffer> member;
+    if (MemoryBuffer::getFile(path.str(), member))
+      return NULL;
+    return member.take();
+  }
   int size = sizeof(ArchiveMemberHeader);
   if (name.startswith("#1/")) {
     APInt name_size;
@@ -174,11 +202,16 @@ error_code Archive::Child::getAsBinary(OwningPtr<Binary> &Result) const {
 }
 
 Archive::Archive(MemoryBuffer *source, error_code &ec)
-  : Binary(Binary::ID_Archive, source) {
+  : Binary(Binary::ID_Archive, source), IsThin(false) {
   // Check for sufficient magic.
   if (!source || source->getBufferSize()
-                 < (8 + sizeof(ArchiveMemberHeader) + 2) // Smallest archive.
-              || StringRef(source->getBufferStart(), 8) != Magic) {
+                 < (8 + sizeof(ArchiveMemberHeader) + 2)) { // Smallest archive.
+    ec = object_error::invalid_file_type;
+    return;
+  }
+  StringRef magic(source->getBufferStart(), 8);
+  IsThin = magic == ThinMagic;
+  if (magic != Magic && !IsThin) {
     ec = object_error::invalid_file_type;
     return;
   }
@@ -187,6 +220,21 @@ Archive::Archive(MemoryBuffer *source, error_code &ec)
   child_iterator i = begin_children(false);
   child_iterator e = end_children();
 
+  if (IsThin) {
+    // Thin archives are always in the GNU format: an optional symbol table
+    // named "/" followed by the string table named "//" for the long names,
+    // which are the paths of all the members.
+    for (; i != e && isInternalMember(*ToHeader(i->Data.data())); ++i) {
+      StringRef name = ToHeader(i->Data.data())->getName();
+      if (name == "/")
+        SymbolTable = i;
+      else if (name == "//")
+        StringTable = i;
+    }
+    ec = object_error::success;
+    return;
+  }
+
   if (i != e) ++i; // Nobody cares about the first member.
   if (i != e) {
     SymbolTable = i;
@@ -201,9 +249,7 @@ Archive::Archive(MemoryBuffer *source, error_code &ec)
 
 Archive::child_iterator Archive::begin_children(bool skip_internal) const {
   const char *Loc = Data->getBufferStart() + strlen(Magic);
-  size_t Size = sizeof(ArchiveMemberHeader) +
-    ToHeader(Loc)->getSize();
-  Child c(this, StringRef(Loc, Size));
+  Child c(this, StringRef(Loc, getMemberSize(this, Loc)));
   // Skip internals at the beginning of an archive.
   if (skip_internal && isInternalMember(*ToHeader(Loc)))
     return c.getNext();
@@ -235,9 +281,7 @@ error_code Archive::Symbol::getMember(child_iterator &Result) const {
                       + (offsetindex - 1));
 
   const char *Loc = Parent->getData().begin() + offset;
-  size_t Size = sizeof(ArchiveMemberHeader) +
-    ToHeader(Loc)->getSize();
-  Result = Child(Parent, StringRef(Loc, Size));
+  Result = Child(Parent, StringRef(Loc, getMemberSize(Parent, Loc)));
 
   return object_error::success;
 }
@@ -54,7 +54,8 @@ sys::IdentifyFileType(const char *magic, unsigned length) {
       break;
     case '!':
       if (length >= 8)
-        if (memcmp(magic,"!<arch>\n",8) == 0)
+        if (memcmp(magic,"!<arch>\n",8) == 0 ||
+            memcmp(magic,"!<thin>\n",8) == 0)
           return Archive_FileType;
       break;
 
@@ -758,7 +758,8 @@ file_magic identify_magic(StringRef magic) {
       break;
     case '!':
       if (magic.size() >= 8)
-        if (memcmp(magic.data(),"!<arch>\n",8) == 0)
+        if (memcmp(magic.data(),"!<arch>\n",8) == 0 ||
+            memcmp(magic.data(),"!<thin>\n",8) == 0)
           return file_magic::archive;
       break;
 
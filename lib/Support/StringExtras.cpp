@@ -57,3 +57,11 @@ void llvm::SplitString(StringRef Source,
     S = getToken(S.second, Delimiters);
   }
 }
+
+uint64_t llvm::HashString64(StringRef Str, uint64_t Result) {
+  for (StringRef::iterator I = Str.begin(), E = Str.end(); I != E; ++I) {
+    Result ^= (unsigned char)*I;
+    Result *= 1099511628211ULL;
+  }
+  return Result;
+}
@@ -80,7 +80,8 @@ public:
 private:
   bool X86FastEmitCompare(const Value *LHS, const Value *RHS, EVT VT);
 
-  bool X86FastEmitLoad(EVT VT, const X86AddressMode &AM, unsigned &RR);
+  bool X86FastEmitLoad(EVT VT, const X86AddressMode &AM, unsigned &RR,
+                       unsigned Alignment = 0);
 
   bool X86FastEmitStore(EVT VT, const Value *Val, const X86AddressMode &AM);
   bool X86FastEmitStore(EVT VT, unsigned Val, const X86AddressMode &AM);
@@ -112,6 +113,9 @@ private:
   bool X86SelectFPExt(const Instruction *I);
   bool X86SelectFPTrunc(const Instruction *I);
 
+  bool X86SelectBitCast(const Instruction *I);
+  bool X86SelectVectorLogicOp(const Instruction *I, unsigned ISDOpcode);
+
   bool X86VisitIntrinsicCall(const IntrinsicInst &I);
   bool X86SelectCall(const Instruction *I);
 
@@ -174,9 +178,11 @@ bool X86FastISel::isTypeLegal(Type *Ty, MVT &VT, bool AllowI1) {
 
 /// X86FastEmitLoad - Emit a machine instruction to load a value of type VT.
 /// The address is either pre-computed, i.e. Ptr, or a GlobalAddress, i.e. GV.
-/// Return true and the result register by reference if it is possible.
+/// Alignment is the known alignment of the address, or 0 if it has the ABI
+/// alignment of VT.  Return true and the result register by reference if it
+/// is possible.
 bool X86FastISel::X86FastEmitLoad(EVT VT, const X86AddressMode &AM,
-                                  unsigned &ResultReg) {
+                                  unsigned &ResultReg, unsigned Alignment) {
   // Get opcode and regclass of the output for the given load instruction.
   unsigned Opc = 0;
   const TargetRegisterClass *RC = NULL;
@@ -221,6 +227,26 @@ bool X86FastISel::X86FastEmitLoad(EVT VT, const X86AddressMode &AM,
   case MVT::f80:
     // No f80 support yet.
     return false;
+  case MVT::v4f32:
+  case MVT::v2f64:
+  case MVT::v4i32:
+  case MVT::v2i64:
+  case MVT::v8i16:
+  case MVT::v16i8: {
+    bool Aligned = Alignment == 0 || Alignment >= 16;
+    bool HasAVX = Subtarget->hasAVX();
+    if (VT == MVT::v4f32)
+      Opc = Aligned ? (HasAVX ? X86::VMOVAPSrm : X86::MOVAPSrm)
+                    : (HasAVX ? X86::VMOVUPSrm : X86::MOVUPSrm);
+    else if (VT == MVT::v2f64)
+      Opc = Aligned ? (HasAVX ? X86::VMOVAPDrm : X86::MOVAPDrm)
+                    : (HasAVX ? X86::VMOVUPDrm : X86::MOVUPDrm);
+    else
+      Opc = Aligned ? (HasAVX ? X86::VMOVDQArm : X86::MOVDQArm)
+                    : (HasAVX ? X86::VMOVDQUrm : X86::MOVDQUrm);
+    RC  = &X86::VR128RegClass;
+    break;
+  }
   }
 
   ResultReg = createResultReg(RC);
@@ -844,7 +870,8 @@ bool X86FastISel::X86SelectLoad(const Instruction *I)  {
     return false;
 
   unsigned ResultReg = 0;
-  if (X86FastEmitLoad(VT, AM, ResultReg)) {
+  if (X86FastEmitLoad(VT, AM, ResultReg,
+                      cast<LoadInst>(I)->getAlignment())) {
     UpdateValueMap(I, ResultReg);
     return true;
   }
@@ -1306,6 +1333,65 @@ bool X86FastISel::X86SelectFPTrunc(const Instruction *I) {
   return false;
 }
 
+/// X86SelectBitCast - Bitcasts between vector types that live in the same
+/// register class, e.g. <4 x float> and <2 x i64>, don't change the bits in
+/// the register, so they are just a copy.  The target-independent code only
+/// handles them when the value types match.
+bool X86FastISel::X86SelectBitCast(const Instruction *I) {
+  MVT SrcVT, DstVT;
+  if (!isTypeLegal(I->getOperand(0)->getType(), SrcVT) ||
+      !isTypeLegal(I->getType(), DstVT) ||
+      !SrcVT.isVector() || !DstVT.isVector())
+    return false;
+
+  const TargetRegisterClass *RC = TLI.getRegClassFor(DstVT);
+  if (RC != TLI.getRegClassFor(SrcVT))
+    return false;
+
+  unsigned OpReg = getRegForValue(I->getOperand(0));
+  if (OpReg == 0)
+    return false;
+
+  unsigned ResultReg = createResultReg(RC);
+  BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(TargetOpcode::COPY),
+          ResultReg).addReg(OpReg);
+  UpdateValueMap(I, ResultReg);
+  return true;
+}
+
+/// X86SelectVectorLogicOp - SSE and AVX only have bitwise instructions for
+/// the i64 vector types; the other integer vector types are promoted to them
+/// by the legalizer, so the generated selectors have no entries for them.
+/// Promote them the same way here, which needs no code since both types live
+/// in the same registers.
+bool X86FastISel::X86SelectVectorLogicOp(const Instruction *I,
+                                         unsigned ISDOpcode) {
+  MVT VT;
+  if (!isTypeLegal(I->getType(), VT) || !VT.isVector() ||
+      TLI.getOperationAction(ISDOpcode, VT) != TargetLowering::Promote)
+    return false;
+
+  MVT PromotedVT = TLI.getTypeToPromoteTo(ISDOpcode, VT).getSimpleVT();
+  if (TLI.getRegClassFor(PromotedVT) != TLI.getRegClassFor(VT))
+    return false;
+
+  unsigned Op0 = getRegForValue(I->getOperand(0));
+  if (Op0 == 0)
+    return false;
+  unsigned Op1 = getRegForValue(I->getOperand(1));
+  if (Op1 == 0)
+    return false;
+
+  unsigned ResultReg = FastEmit_rr(PromotedVT, PromotedVT, ISDOpcode,
+                                   Op0, /*TODO: Kill=*/false,
+                                   Op1, /*TODO: Kill=*/false);
+  if (ResultReg == 0)
+    return false;
+
+  UpdateValueMap(I, ResultReg);
+  return true;
+}
+
 bool X86FastISel::X86SelectTrunc(const Instruction *I) {
   EVT SrcVT = TLI.getValueType(I->getOperand(0)->getType());
   EVT DstVT = TLI.getValueType(I->getType());
@@ -1469,6 +1555,24 @@ bool X86FastISel::X86VisitIntrinsicCall(const IntrinsicInst &I) {
     BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(X86::TRAP));
     return true;
   }
+  case Intrinsic::sqrt: {
+    // SelectionDAG turns this into an FSQRT node; use its selector.
+    MVT VT;
+    if (!isTypeLegal(I.getType(), VT))
+      return false;
+
+    unsigned OpReg = getRegForValue(I.getArgOperand(0));
+    if (OpReg == 0)
+      return false;
+
+    unsigned ResultReg = FastEmit_r(VT, VT, ISD::FSQRT, OpReg,
+                                    /*TODO: Kill=*/false);
+    if (ResultReg == 0)
+      return false;
+
+    UpdateValueMap(&I, ResultReg);
+    return true;
+  }
   case Intrinsic::sadd_with_overflow:
   case Intrinsic::uadd_with_overflow: {
     // FIXME: Should fold immediates.
@@ -2007,6 +2111,14 @@ X86FastISel::TargetSelectInstruction(const Instruction *I)  {
     return X86SelectFPExt(I);
   case Instruction::FPTrunc:
     return X86SelectFPTrunc(I);
+  case Instruction::BitCast:
+    return X86SelectBitCast(I);
+  case Instruction::And:
+    return X86SelectVectorLogicOp(I, ISD::AND);
+  case Instruction::Or:
+    return X86SelectVectorLogicOp(I, ISD::OR);
+  case Instruction::Xor:
+    return X86SelectVectorLogicOp(I, ISD::XOR);
   case Instruction::IntToPtr: // Deliberate fall-through.
   case Instruction::PtrToInt: {
     EVT SrcVT = TLI.getValueType(I->getOperand(0)->getType());
@@ -142,6 +142,11 @@ FunctionPass *llvm::createCodeGenPreparePass(const TargetLowering *TLI) {
 }
 
 bool CodeGenPrepare::runOnFunction(Function &F) {
+  // 'available_externally' functions are not code generated, so there is no
+  // point in preparing them.
+  if (F.hasAvailableExternallyLinkage())
+    return false;
+
   bool EverMadeChange = false;
 
   ModifiedDT = false;
@@ -23,7 +23,6 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
-#include <map>
 
 namespace llvm {
 template<class ValType>
@@ -333,20 +332,39 @@ struct ExprMapKeyType {
            this->operands == that.operands &&
            this->indices == that.indices;
   }
-  bool operator<(const ExprMapKeyType & that) const {
-    if (this->opcode != that.opcode) return this->opcode < that.opcode;
-    if (this->operands != that.operands) return this->operands < that.operands;
-    if (this->subclassdata != that.subclassdata)
-      return this->subclassdata < that.subclassdata;
-    if (this->subclassoptionaldata != that.subclassoptionaldata)
-      return this->subclassoptionaldata < that.subclassoptionaldata;
-    if (this->indices != that.indices) return this->indices < that.indices;
-    return false;
-  }
-
   bool operator!=(const ExprMapKeyType& that) const {
     return !(*this == that);
   }
+
+  /// operator== - Compare this key against an existing constant expression
+  /// without building a key for it.
+  bool operator==(const ConstantExpr *CE) const {
+    if (opcode != CE->getOpcode())
+      return false;
+    if (subclassoptionaldata != CE->getRawSubclassOptionalData())
+      return false;
+    if (subclassdata != (CE->isCompare() ? CE->getPredicate() : 0))
+      return false;
+    if (operands.size() != CE->getNumOperands())
+      return false;
+    for (unsigned i = 0, e = operands.size(); i != e; ++i)
+      if (operands[i] != CE->getOperand(i))
+        return false;
+    ArrayRef<unsigned> CEIndices =
+      CE->hasIndices() ? CE->getIndices() : ArrayRef<unsigned>();
+    if (indices.size() != CEIndices.size())
+      return false;
+    for (unsigned i = 0, e = indices.size(); i != e; ++i)
+      if (indices[i] != CEIndices[i])
+        return false;
+    return true;
+  }
+
+  unsigned getHash() const {
+    return hash_combine(opcode, subclassoptionaldata, subclassdata,
+                        hash_combine_range(operands.begin(), operands.end()),
+                        hash_combine_range(indices.begin(), indices.end()));
+  }
 };
 
 struct InlineAsmKeyType {
@@ -368,23 +386,26 @@ struct InlineAsmKeyType {
            this->is_align_stack == that.is_align_stack &&
            this->asm_dialect == that.asm_dialect;
   }
-  bool operator<(const InlineAsmKeyType& that) const {
-    if (this->asm_string != that.asm_string)
-      return this->asm_string < that.asm_string;
-    if (this->constraints != that.constraints)
-      return this->constraints < that.constraints;
-    if (this->has_side_effects != that.has_side_effects)
-      return this->has_side_effects < that.has_side_effects;
-    if (this->is_align_stack != that.is_align_stack)
-      return this->is_align_stack < that.is_align_stack;
-    if (this->asm_dialect != that.asm_dialect)
-      return this->asm_dialect < that.asm_dialect;
-    return false;
-  }
-
   bool operator!=(const InlineAsmKeyType& that) const {
     return !(*this == that);
   }
+
+  /// operator== - Compare this key against an existing InlineAsm.
+  bool operator==(const InlineAsm *Asm) const {
+    return asm_string == Asm->getAsmString() &&
+           constraints == Asm->getConstraintString() &&
+           has_side_effects == Asm->hasSideEffects() &&
+           is_align_stack == Asm->isAlignStack() &&
+           asm_dialect == Asm->getDialect();
+  }
+
+  unsigned getHash() const {
+    return hash_combine(hash_combine_range(asm_string.begin(),
+                                           asm_string.end()),
+                        hash_combine_range(constraints.begin(),
+                                           constraints.end()),
+                        has_side_effects, is_align_stack, asm_dialect);
+  }
 };
 
 // The number of operands for each ConstantCreator::create method is
@@ -510,24 +531,47 @@ struct ConstantKeyData<InlineAsm> {
   }
 };
 
-template<class ValType, class ValRefType, class TypeClass, class ConstantClass,
-         bool HasLargeKey = false /*true for arrays and structs*/ >
+template<class ValType, class ValRefType, class TypeClass, class ConstantClass>
 class ConstantUniqueMap {
 public:
-  typedef std::pair<TypeClass*, ValType> MapKey;
-  typedef std::map<MapKey, ConstantClass *> MapTy;
-  typedef std::map<ConstantClass *, typename MapTy::iterator> InverseMapTy;
+  typedef std::pair<TypeClass*, const ValType*> LookupKey;
+private:
+  struct MapInfo {
+    typedef DenseMapInfo<ConstantClass*> ConstantClassInfo;
+    static inline ConstantClass* getEmptyKey() {
+      return ConstantClassInfo::getEmptyKey();
+    }
+    static inline ConstantClass* getTombstoneKey() {
+      return ConstantClassInfo::getTombstoneKey();
+    }
+    static unsigned getHashValue(const ConstantClass *CP) {
+      ConstantClass *C = const_cast<ConstantClass*>(CP);
+      ValType V = ConstantKeyData<ConstantClass>::getValType(C);
+      return getHashValue(LookupKey(static_cast<TypeClass*>(C->getType()), &V));
+    }
+    static bool isEqual(const ConstantClass *LHS, const ConstantClass *RHS) {
+      return LHS == RHS;
+    }
+    static unsigned getHashValue(const LookupKey &Val) {
+      return hash_combine(Val.first, Val.second->getHash());
+    }
+    static bool isEqual(const LookupKey &LHS, const ConstantClass *RHS) {
+      if (RHS == getEmptyKey() || RHS == getTombstoneKey())
+        return false;
+      if (LHS.first != RHS->getType())
+        return false;
+      return *LHS.second == RHS;
+    }
+  };
+public:
+  typedef DenseMap<ConstantClass *, char, MapInfo> MapTy;
+
 private:
   /// Map - This is the main map from the element descriptor to the Constants.
   /// This is the primary way we avoid creating two of the same shape
-  /// constant.
+  /// constant.  Lookups hash the descriptor and compare it against the
+  /// candidate constants in place, so no key is materialized on a hit.
   MapTy Map;
-    
-  /// InverseMap - If "HasLargeKey" is true, this contains an inverse mapping
-  /// from the constants to their element in Map.  This is important for
-  /// removal of constants from the array, which would otherwise have to scan
-  /// through the map with very large keys.
-  InverseMapTy InverseMap;
 
 public:
   typename MapTy::iterator map_begin() { return Map.begin(); }
@@ -537,110 +581,42 @@ public:
     for (typename MapTy::iterator I=Map.begin(), E=Map.end();
          I != E; ++I) {
       // Asserts that use_empty().
-      delete I->second;
-    }
-  }
-    
-  /// InsertOrGetItem - Return an iterator for the specified element.
-  /// If the element exists in the map, the returned iterator points to the
-  /// entry and Exists=true.  If not, the iterator points to the newly
-  /// inserted entry and returns Exists=false.  Newly inserted entries have
-  /// I->second == 0, and should be filled in.
-  typename MapTy::iterator InsertOrGetItem(std::pair<MapKey, ConstantClass *>
-                                 &InsertVal,
-                                 bool &Exists) {
-    std::pair<typename MapTy::iterator, bool> IP = Map.insert(InsertVal);
-    Exists = !IP.second;
-    return IP.first;
-  }
-    
-private:
-  typename MapTy::iterator FindExistingElement(ConstantClass *CP) {
-    if (HasLargeKey) {
-      typename InverseMapTy::iterator IMI = InverseMap.find(CP);
-      assert(IMI != InverseMap.end() && IMI->second != Map.end() &&
-             IMI->second->second == CP &&
-             "InverseMap corrupt!");
-      return IMI->second;
-    }
-      
-    typename MapTy::iterator I =
-      Map.find(MapKey(static_cast<TypeClass*>(CP->getType()),
-                      ConstantKeyData<ConstantClass>::getValType(CP)));
-    if (I == Map.end() || I->second != CP) {
-      // FIXME: This should not use a linear scan.  If this gets to be a
-      // performance problem, someone should look at this.
-      for (I = Map.begin(); I != Map.end() && I->second != CP; ++I)
-        /* empty */;
+      delete I->first;
     }
-    return I;
   }
 
-  ConstantClass *Create(TypeClass *Ty, ValRefType V,
-                        typename MapTy::iterator I) {
+private:
+  ConstantClass *Create(TypeClass *Ty, ValRefType V) {
     ConstantClass* Result =
       ConstantCreator<ConstantClass,TypeClass,ValType>::create(Ty, V);
 
     assert(Result->getType() == Ty && "Type specified is not correct!");
-    I = Map.insert(I, std::make_pair(MapKey(Ty, V), Result));
-
-    if (HasLargeKey)  // Remember the reverse mapping if needed.
-      InverseMap.insert(std::make_pair(Result, I));
+    Map[Result] = '\0';
 
     return Result;
   }
 public:
-    
+
   /// getOrCreate - Return the specified constant from the map, creating it if
   /// necessary.
   ConstantClass *getOrCreate(TypeClass *Ty, ValRefType V) {
-    MapKey Lookup(Ty, V);
-    ConstantClass* Result = 0;
-    
-    typename MapTy::iterator I = Map.find(Lookup);
-    // Is it in the map?  
+    typename MapTy::iterator I = Map.find_as(LookupKey(Ty, &V));
+    // Is it in the map?
     if (I != Map.end())
-      Result = I->second;
-        
-    if (!Result) {
-      // If no preexisting value, create one now...
-      Result = Create(Ty, V, I);
-    }
-        
-    return Result;
+      return I->first;
+
+    // If no preexisting value, create one now...
+    return Create(Ty, V);
   }
 
+  /// Remove this constant from the map
   void remove(ConstantClass *CP) {
-    typename MapTy::iterator I = FindExistingElement(CP);
+    typename MapTy::iterator I = Map.find(CP);
     assert(I != Map.end() && "Constant not found in constant table!");
-    assert(I->second == CP && "Didn't find correct element?");
-
-    if (HasLargeKey)  // Remember the reverse mapping if needed.
-      InverseMap.erase(CP);
-
+    assert(I->first == CP && "Didn't find correct element?");
     Map.erase(I);
   }
 
-  /// MoveConstantToNewSlot - If we are about to change C to be the element
-  /// specified by I, update our internal data structures to reflect this
-  /// fact.
-  void MoveConstantToNewSlot(ConstantClass *C, typename MapTy::iterator I) {
-    // First, remove the old location of the specified constant in the map.
-    typename MapTy::iterator OldI = FindExistingElement(C);
-    assert(OldI != Map.end() && "Constant not found in constant table!");
-    assert(OldI->second == C && "Didn't find correct element?");
-      
-     // Remove the old entry from the map.
-    Map.erase(OldI);
-    
-    // Update the inverse map so that we know that this constant is now
-    // located at descriptor I.
-    if (HasLargeKey) {
-      assert(I->second == C && "Bad inversemap entry!");
-      InverseMap[C] = I;
-    }
-  }
-
   void dump() const {
     DEBUG(dbgs() << "Constant.cpp: ConstantUniqueMap\n");
   }
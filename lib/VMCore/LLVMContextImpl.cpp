@@ -41,18 +41,8 @@ LLVMContextImpl::LLVMContextImpl(LLVMContext &C)
 }
 
 namespace {
-struct DropReferences {
-  // Takes the value_type of a ConstantUniqueMap's internal map, whose 'second'
-  // is a Constant*.
-  template<typename PairT>
-  void operator()(const PairT &P) {
-    P.second->dropAllReferences();
-  }
-};
-
-// Temporary - drops pair.first instead of second.
 struct DropFirst {
-  // Takes the value_type of a ConstantUniqueMap's internal map, whose 'second'
+  // Takes the value_type of a ConstantUniqueMap's internal map, whose 'first'
   // is a Constant*.
   template<typename PairT>
   void operator()(const PairT &P) {
@@ -72,7 +62,7 @@ LLVMContextImpl::~LLVMContextImpl() {
   // Free the constants.  This is important to do here to ensure that they are
   // freed before the LeakDetector is torn down.
   std::for_each(ExprConstants.map_begin(), ExprConstants.map_end(),
-                DropReferences());
+                DropFirst());
   std::for_each(ArrayConstants.map_begin(), ArrayConstants.map_end(),
                 DropFirst());
   std::for_each(StructConstants.map_begin(), StructConstants.map_end(),
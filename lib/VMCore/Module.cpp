@@ -421,6 +421,12 @@ bool Module::MaterializeAll(std::string *ErrInfo) {
   return Materializer->MaterializeModule(this, ErrInfo);
 }
 
+bool Module::MaterializeMetadata(std::string *ErrInfo) {
+  if (!Materializer)
+    return false;
+  return Materializer->MaterializeMetadata(ErrInfo);
+}
+
 bool Module::MaterializeAllPermanently(std::string *ErrInfo) {
   if (MaterializeAll(ErrInfo))
     return true;
@@ -0,0 +1,32 @@
+; This isn't really an assembly file, its just here to run the test.
+
+; Check that every symbol of an archive with many members is found in the
+; symbol table read back from disk, and is mapped to the member defining it.
+; Each member defines @f<i> and @g<i>, so the two symbols share an offset.
+
+; RUN: rm -rf %t && mkdir -p %t && cd %t
+; RUN: for i in $(seq 1 300); do \
+; RUN:   echo "define void @f$i() { ret void } define void @g$i() { ret void }" \
+; RUN:     | llvm-as -o m$i.bc; \
+; RUN: done
+; RUN: llvm-ar rcs lib.a $(for i in $(seq 1 300); do echo m$i.bc; done)
+; RUN: llvm-ar tV lib.a > %t.symtab
+; RUN: FileCheck %s < %t.symtab
+; RUN: grep -c -E "[0-9]+.[fg][0-9]+$" %t.symtab \
+; RUN:   | FileCheck --check-prefix=COUNT %s
+; RUN: llvm-nm lib.a | FileCheck --check-prefix=NM %s
+
+; CHECK: Archive Symbol Table:
+; CHECK-NEXT: [[F1:[0-9]+]] f1
+; CHECK-NEXT: [[F10:[0-9]+]] f10
+; CHECK: [[F300:[0-9]+]] f300
+; CHECK: [[F1]] g1
+; CHECK-NEXT: [[F10]] g10
+; CHECK: [[F300]] g300
+
+; COUNT: 600
+
+; NM: T f1
+; NM-NEXT: T g1
+; NM: T f300
+; NM-NEXT: T g300
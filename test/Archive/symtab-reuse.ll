@@ -0,0 +1,28 @@
+; This isn't really an assembly file, its just here to run the test.
+
+; Check that the symbol table stays correct when llvm-ar rewrites an archive
+; and reuses the symbols of the members it writes unchanged.  @g is defined
+; by the first and the last member, so the old symbol table only lists it
+; under the first one; once that is deleted, @g must move to the last member.
+
+; RUN: rm -rf %t && mkdir -p %t && cd %t
+; RUN: echo "define void @f() { ret void } define void @g() { ret void }" | \
+; RUN:   llvm-as -o m1.bc
+; RUN: echo "define void @h() { ret void }" | llvm-as -o m2.bc
+; RUN: echo "define void @g() { ret void } define void @k() { ret void }" | \
+; RUN:   llvm-as -o m3.bc
+; RUN: llvm-ar rcs lib.a m1.bc m2.bc m3.bc
+; RUN: llvm-ar tV lib.a | FileCheck --check-prefix=BEFORE %s
+; RUN: llvm-ar ds lib.a m1.bc
+; RUN: llvm-ar tV lib.a | FileCheck --check-prefix=AFTER %s
+
+; BEFORE: Archive Symbol Table:
+; BEFORE-NEXT: [[M1:[0-9]+]] f
+; BEFORE-NEXT: [[M1]] g
+; BEFORE-NEXT: h
+; BEFORE-NEXT: k
+
+; AFTER: Archive Symbol Table:
+; AFTER-NEXT: [[M3:[0-9]+]] g
+; AFTER-NEXT: h
+; AFTER-NEXT: [[M3]] k
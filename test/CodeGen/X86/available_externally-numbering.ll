@@ -0,0 +1,29 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu | FileCheck %s
+
+; No machine code is built for @inlinable, but it still takes a function
+; number so that the block labels in @caller are unaffected.
+
+; CHECK-NOT: inlinable:
+; CHECK: caller:
+; CHECK: .LBB1_
+
+define available_externally i32 @inlinable(i32 %x) nounwind {
+entry:
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %zero, label %nonzero
+zero:
+  ret i32 1
+nonzero:
+  ret i32 %x
+}
+
+define i32 @caller(i32 %x) nounwind {
+entry:
+  %c = icmp sgt i32 %x, 10
+  br i1 %c, label %big, label %small
+big:
+  %r = call i32 @inlinable(i32 %x)
+  ret i32 %r
+small:
+  ret i32 0
+}
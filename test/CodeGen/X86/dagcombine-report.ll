@@ -0,0 +1,25 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -combiner-report \
+; RUN:   -o /dev/null 2>&1 | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -combiner-report \
+; RUN:   -combiner-topological-order -o /dev/null 2>&1 | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu \
+; RUN:   -combiner-topological-order | FileCheck %s --check-prefix=CODE
+
+; CHECK: DAG Combiner Report
+; CHECK: {{[0-9]+}}  node visits
+; CHECK-NEXT: {{[0-9]+}}  distinct nodes visited
+; CHECK-NEXT: {{[0-9]+}}  most visits of one node
+; CHECK: Attempted Combined Opcode
+; CHECK: {{[0-9]+ +1}}  mul
+
+; CODE: f:
+; CODE: leal (%rsi,%rdi,8), %eax
+; CODE-NEXT: notl %eax
+
+define i32 @f(i32 %x, i32 %y) nounwind {
+entry:
+  %a = mul i32 %x, 8
+  %b = add i32 %a, %y
+  %c = xor i32 %b, -1
+  ret i32 %c
+}
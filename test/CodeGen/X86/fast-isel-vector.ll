@@ -0,0 +1,60 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -mattr=-avx -O0 \
+; RUN:   -asm-verbose=0 -fast-isel-abort | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -mattr=+avx -O0 \
+; RUN:   -asm-verbose=0 -fast-isel-abort | FileCheck %s --check-prefix=AVX
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -mattr=+avx -O0 \
+; RUN:   -fast-isel-report -o /dev/null 2>&1 | FileCheck %s --check-prefix=REPORT
+
+; Vector loads pick the aligned or unaligned move by the load's alignment.
+; CHECK: loads:
+; CHECK: movaps (%rdi)
+; CHECK: movups (%rsi)
+; AVX: loads:
+; AVX: vmovaps (%rdi)
+; AVX: vmovups (%rsi)
+define <4 x float> @loads(<4 x float>* %p, <4 x float>* %q) nounwind {
+  %a = load <4 x float>* %p, align 16
+  %b = load <4 x float>* %q, align 4
+  %c = fadd <4 x float> %a, %b
+  ret <4 x float> %c
+}
+
+; Bitcasts between vector types are copies, and logic ops on <4 x i32> use
+; the <2 x i64> instructions.
+; CHECK: logic:
+; CHECK: xorps
+; AVX: logic:
+; AVX: vpxor
+define <4 x i32> @logic(<4 x float> %a, <4 x i32> %b) nounwind {
+  %c = bitcast <4 x float> %a to <4 x i32>
+  %d = xor <4 x i32> %c, %b
+  ret <4 x i32> %d
+}
+
+; With AVX the scalar conversions and square roots take an undefined first
+; operand.
+; CHECK: scalar:
+; CHECK: cvtsi2sd %edi
+; CHECK: sqrtsd
+; AVX: scalar:
+; AVX: vcvtsi2sd %edi, %xmm{{[0-9]+}}, %xmm
+; AVX: vsqrtsd
+define double @scalar(i32 %i) nounwind {
+  %d = sitofp i32 %i to double
+  %s = call double @llvm.sqrt.f64(double %d)
+  ret double %s
+}
+
+; Target intrinsics still go to SelectionDAG.
+; REPORT: Fast Instruction Selection Misses
+; REPORT: {{[0-9]+}} instructions selected by fast isel
+; REPORT-NEXT: 1 instructions selected by SelectionDAG
+; REPORT: Misses DAG Insts Instruction
+; REPORT-NEXT: 1 1 call @llvm.x86.sse.max.ps (vector)
+define <4 x float> @target_intrinsic(<4 x float> %a, <4 x float> %b) nounwind {
+  %c = call <4 x float> @llvm.x86.sse.max.ps(<4 x float> %a, <4 x float> %b)
+  ret <4 x float> %c
+}
+
+declare double @llvm.sqrt.f64(double)
+declare <4 x float> @llvm.x86.sse.max.ps(<4 x float>, <4 x float>)
@@ -200,7 +200,7 @@ block2:
 ; CHECK: callq _test16callee
 
 ; AVX: movabsq $1
-; AVX: vmovsd LCP{{.*}}_{{.*}}(%rip), %xmm0
+; AVX: vcvtsi2sdq {{.*}} %xmm0
 ; AVX: movb $1, %al
 ; AVX: callq _test16callee
   call void (...)* @test16callee(double 1.000000e+00)
@@ -0,0 +1,74 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -verify-machineinstrs \
+; RUN:   | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -verify-machineinstrs \
+; RUN:   -isel-max-dag-region-size=2 | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -verify-machineinstrs \
+; RUN:   -isel-max-dag-region-size=3 -isel-node-budget=10 | FileCheck %s
+
+; The statistics show that the blocks were split and that the budget made
+; isel fall back to fast isel and the fast scheduler.
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -o /dev/null -stats 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=NOSPLIT
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -o /dev/null -stats \
+; RUN:   -isel-max-dag-region-size=2 2>&1 | FileCheck %s -check-prefix=SPLIT
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -o /dev/null -stats \
+; RUN:   -isel-max-dag-region-size=3 -isel-node-budget=10 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=BUDGET
+
+; NOSPLIT-NOT: Number of extra DAGs built by splitting large blocks
+; NOSPLIT-NOT: over budget
+
+; SPLIT-NOT: over budget
+; SPLIT: {{[1-9][0-9]*}} isel - Number of extra DAGs built by splitting large blocks
+; SPLIT-NOT: over budget
+
+; BUDGET: {{[1-9][0-9]*}} isel - Number of DAGs scheduled by the fast scheduler over budget
+; BUDGET: {{[1-9][0-9]*}} isel - Number of blocks given to fast isel over budget
+; BUDGET: {{[1-9][0-9]*}} isel - Number of extra DAGs built by splitting large blocks
+; BUDGET: {{[1-9][0-9]*}} isel - Number of functions that went over the isel node budget
+
+; Splitting blocks into several DAGs, and falling back to fast isel and the
+; fast scheduler over budget, must still produce correct code. Values are
+; used across region boundaries by later instructions, by the branch, and by
+; a phi in the successor.
+
+; CHECK: test:
+; CHECK: imul
+; CHECK: ret
+
+define i32 @test(i32 %a, i32 %b, i32* %p) nounwind {
+entry:
+  %slot = alloca i32
+  %x = add i32 %a, %b
+  %y = mul i32 %x, %a
+  store i32 %y, i32* %slot
+  %z = sub i32 %y, %b
+  %l = load i32* %p
+  %w = xor i32 %z, %l
+  %c = icmp sgt i32 %w, %x
+  br i1 %c, label %then, label %done
+
+then:
+  %v = load i32* %slot
+  %u = add i32 %v, %z
+  %s = shl i32 %u, 2
+  %t = or i32 %s, %x
+  br label %done
+
+done:
+  %r = phi i32 [ %w, %entry ], [ %t, %then ]
+  ret i32 %r
+}
+
+; CHECK: tail:
+; CHECK: jmp callee
+define i32 @tail(i32 %a) nounwind {
+entry:
+  %x = add i32 %a, 1
+  %y = mul i32 %x, %x
+  %z = add i32 %y, %a
+  %r = tail call i32 @callee(i32 %z) nounwind
+  ret i32 %r
+}
+
+declare i32 @callee(i32)
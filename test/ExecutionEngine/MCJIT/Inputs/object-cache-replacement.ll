@@ -0,0 +1,9 @@
+@msg = internal global [12 x i8] c"replacement\00"
+
+declare i32 @puts(i8*)
+
+define i32 @main() {
+entry:
+  %0 = call i32 @puts(i8* getelementptr ([12 x i8]* @msg, i64 0, i64 0))
+  ret i32 0
+}
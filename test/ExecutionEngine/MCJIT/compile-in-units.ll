@@ -0,0 +1,60 @@
+; RUN: %lli -mtriple=%mcjit_triple -use-mcjit -mcjit-compile-in-units %s \
+; RUN:   | FileCheck %s
+; RUN: not %lli -mtriple=%mcjit_triple -use-mcjit %s 2>&1 \
+; RUN:   | FileCheck -check-prefix=WHOLE %s
+
+; With -mcjit-compile-in-units, the static constructor and @main are compiled
+; in two units, neither of which contains @unused, which refers to a function
+; that cannot be resolved.  The unnamed global and the symbol defined by
+; module asm are used by both units, so they have to be defined exactly once:
+; @main must see the constructor's store to @asm_value.  Without the option
+; the whole module is compiled and @unused fails to link.
+
+; CHECK: first 42
+; CHECK: second 42 44
+; WHOLE: mcjit_units_missing
+
+module asm "\09.data"
+module asm "\09.globl\09asm_value"
+module asm "asm_value:"
+module asm "\09.long\0943"
+
+@0 = internal global i32 42
+@asm_value = external global i32
+@first.fmt = internal constant [10 x i8] c"first %d\0A\00"
+@second.fmt = internal constant [14 x i8] c"second %d %d\0A\00"
+@llvm.global_ctors = appending global [1 x { i32, void ()* }] [{ i32, void ()* } { i32 65535, void ()* @init }]
+
+declare i32 @printf(i8*, ...)
+declare i32 @mcjit_units_missing()
+
+define internal i32 @load() {
+entry:
+  %v = load i32* @0
+  ret i32 %v
+}
+
+define internal void @init() {
+entry:
+  %v = call i32 @load()
+  %p = getelementptr [10 x i8]* @first.fmt, i64 0, i64 0
+  %0 = call i32 (i8*, ...)* @printf(i8* %p, i32 %v)
+  store i32 44, i32* @asm_value
+  ret void
+}
+
+define i32 @unused() {
+entry:
+  %r = call i32 @mcjit_units_missing()
+  ret i32 %r
+}
+
+define i32 @main() {
+entry:
+  %v = call i32 @load()
+  %w = load i32* @0
+  %a = load i32* @asm_value
+  %p = getelementptr [14 x i8]* @second.fmt, i64 0, i64 0
+  %0 = call i32 (i8*, ...)* @printf(i8* %p, i32 %w, i32 %a)
+  ret i32 0
+}
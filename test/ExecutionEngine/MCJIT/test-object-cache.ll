@@ -0,0 +1,28 @@
+; RUN: rm -rf %t.cache %t.other
+; RUN: %lli -mtriple=%mcjit_triple -use-mcjit -object-cache-dir=%t.cache %s \
+; RUN:   | FileCheck -check-prefix=FIRST %s
+; RUN: ls %t.cache | FileCheck -check-prefix=CACHE %s
+; RUN: %lli -mtriple=%mcjit_triple -use-mcjit -object-cache-dir=%t.other \
+; RUN:   %p/Inputs/object-cache-replacement.ll > /dev/null
+; RUN: for f in %t.cache/*.o; do cp %t.other/*.o $f; done
+; RUN: %lli -mtriple=%mcjit_triple -use-mcjit -object-cache-dir=%t.cache %s \
+; RUN:   | FileCheck -check-prefix=SECOND %s
+
+; The first run leaves the generated object in the cache directory.  The
+; cached object is then replaced by the one for a module that prints
+; something else, so the second run only prints that if it loaded the object
+; from the cache instead of generating code again.
+
+; FIRST: original
+; CACHE: .o
+; SECOND: replacement
+
+@msg = internal global [9 x i8] c"original\00"
+
+declare i32 @puts(i8*)
+
+define i32 @main() {
+entry:
+  %0 = call i32 @puts(i8* getelementptr ([9 x i8]* @msg, i64 0, i64 0))
+  ret i32 0
+}
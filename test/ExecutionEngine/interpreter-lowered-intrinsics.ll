@@ -0,0 +1,64 @@
+; RUN: %lli -force-interpreter=true %s | FileCheck %s
+
+; Intrinsic calls are lowered the first time the interpreter executes them.
+; Frames of the same function that are still live, including callers about
+; to execute the lowered call, have to continue in the new code.
+
+; CHECK: loop 5248
+; CHECK: rec 319
+
+@loopfmt = private constant [9 x i8] c"loop %d\0A\00"
+@recfmt = private constant [8 x i8] c"rec %d\0A\00"
+
+declare i32 @printf(i8*, ...)
+declare i32 @llvm.ctpop.i32(i32)
+declare i32 @llvm.bswap.i32(i32)
+
+define i32 @loop(i32 %n) {
+entry:
+  br label %body
+
+body:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %body ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %body ]
+  %pop = call i32 @llvm.ctpop.i32(i32 %i)
+  %swapped = call i32 @llvm.bswap.i32(i32 %pop)
+  %high = lshr i32 %swapped, 24
+  %acc.next = add i32 %acc, %high
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %body
+
+exit:
+  ret i32 %acc.next
+}
+
+define i32 @rec(i32 %n) {
+entry:
+  %zero = icmp eq i32 %n, 0
+  br i1 %zero, label %base, label %more
+
+base:
+  ret i32 0
+
+more:
+  %m = sub i32 %n, 1
+  %r = call i32 @rec(i32 %m)
+  %pop = call i32 @llvm.ctpop.i32(i32 %n)
+  %swapped = call i32 @llvm.bswap.i32(i32 %pop)
+  %high = lshr i32 %swapped, 24
+  %sum = add i32 %r, %high
+  ret i32 %sum
+}
+
+define i32 @main() {
+  %a = call i32 @loop(i32 100)
+  %b = call i32 @loop(i32 1000)
+  %l = add i32 %a, %b
+  %lf = getelementptr [9 x i8]* @loopfmt, i32 0, i32 0
+  call i32 (i8*, ...)* @printf(i8* %lf, i32 %l)
+  %r = call i32 @rec(i32 100)
+  %rf = getelementptr [8 x i8]* @recfmt, i32 0, i32 0
+  call i32 (i8*, ...)* @printf(i8* %rf, i32 %r)
+  ret i32 0
+}
@@ -0,0 +1,19 @@
+declare i32 @a(i32)
+
+define i32 @b(i32 %x) {
+entry:
+  %r = call i32 @a(i32 %x)
+  ret i32 %r
+}
+
+define internal i32 @c(i32 %x) {
+entry:
+  %r = mul i32 %x, 3
+  ret i32 %r
+}
+
+define i32 @d(i32 %x) {
+entry:
+  %r = call i32 @c(i32 %x)
+  ret i32 %r
+}
@@ -0,0 +1,6 @@
+%t.1 = type { i32, %v.1* }
+%v.1 = type { i8 }
+%u.1 = type { i32 }
+
+@a = global %t.1 zeroinitializer
+@c = global %u.1 zeroinitializer
@@ -0,0 +1,6 @@
+%t.2 = type { i32, %v.2* }
+%v.2 = type { i8 }
+%u.2 = type { i64 }
+
+@b = global %t.2 zeroinitializer
+@d = global %u.2 zeroinitializer
@@ -0,0 +1,28 @@
+; RUN: llvm-link -v -stats %s %p/Inputs/lazy-bodies.b.ll -o %t.bc 2>&1 \
+; RUN:   | FileCheck -check-prefix=STATS %s
+; RUN: llvm-dis < %t.bc | FileCheck %s
+
+; Every input after the first is read lazily and its bodies are moved into
+; the composite module one at a time rather than cloned.
+
+; STATS: Linked '{{.*}}lazy-bodies.b.ll' in {{.*}}s, heap usage {{[0-9]+}} KB
+; STATS: Peak heap usage while linking: {{[0-9]+}} KB
+; STATS-NOT: cloned
+; STATS: 3 linker {{.*}} Number of function bodies moved from the source
+; STATS-NOT: cloned
+; STATS: 1 llvm-link {{.*}} Number of input modules linked
+
+; CHECK: define i32 @a(i32 %x)
+; CHECK: add i32 %x, 1
+; CHECK: define i32 @b(i32 %x)
+; CHECK: call i32 @a(i32 %x)
+; CHECK: define internal i32 @c(i32 %x)
+; CHECK: mul i32 %x, 3
+; CHECK: define i32 @d(i32 %x)
+; CHECK: call i32 @c(i32 %x)
+
+define i32 @a(i32 %x) {
+entry:
+  %r = add i32 %x, 1
+  ret i32 %r
+}
@@ -0,0 +1,18 @@
+; RUN: llvm-link %S/Inputs/type-renamed-copies.a.ll \
+; RUN:   %S/Inputs/type-renamed-copies.b.ll -S | FileCheck %s
+
+; Both inputs only have renamed copies of %t, %u and %v.  The isomorphic
+; copies of %t and %v are merged; the copies of %u have different bodies and
+; are kept apart.
+
+; CHECK-NOT: %t.2 = type
+; CHECK-NOT: %v.2 = type
+; CHECK: %t.1 = type { i32, %v.1* }
+; CHECK: %v.1 = type { i8 }
+; CHECK: %u.1 = type { i32 }
+; CHECK: %u.2 = type { i64 }
+
+; CHECK: @a = global %t.1 zeroinitializer
+; CHECK: @c = global %u.1 zeroinitializer
+; CHECK: @b = global %t.1 zeroinitializer
+; CHECK: @d = global %u.2 zeroinitializer
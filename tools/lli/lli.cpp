@@ -28,6 +28,7 @@
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/JITMemoryManager.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/IRReader.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -43,6 +44,7 @@
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/Memory.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Target/TargetMachine.h"
 #include <cerrno>
 
 #ifdef __linux__
@@ -135,6 +137,17 @@ namespace {
                   cl::desc("Disable JIT lazy compilation"),
                   cl::init(false));
 
+  cl::opt<bool>
+  CompileInUnits("mcjit-compile-in-units",
+                 cl::desc("Compile lazily in per-function units (MCJIT only)"),
+                 cl::init(false));
+
+  cl::opt<unsigned>
+  TierUpThreshold("jit-tier-up-threshold",
+                  cl::desc("Recompile functions with the full code generator "
+                           "after this many calls (0 disables)"),
+                  cl::init(0));
+
   cl::opt<Reloc::Model>
   RelocModel("relocation-model",
              cl::desc("Choose relocation model"),
@@ -205,14 +218,21 @@ namespace {
     cl::Hidden,
     cl::desc("Emit debug info objfiles to disk"),
     cl::init(false));
+
+  cl::opt<std::string>
+  ObjectCacheDir("object-cache-dir",
+    cl::desc("Reuse objects generated by MCJIT from this directory"),
+    cl::value_desc("directory"));
 }
 
 static ExecutionEngine *EE = 0;
+static ObjectCache *ObjCache = 0;
 
 static void do_shutdown() {
   // Cygwin-1.5 invokes DLL's dtors before atexit handler.
 #ifndef DO_NOTHING_ATEXIT
   delete EE;
+  delete ObjCache;
   llvm_shutdown();
 #endif
 }
@@ -601,7 +621,11 @@ int main(int argc, char **argv, char * const *envp) {
 
   builder.setTargetOptions(Options);
 
-  EE = builder.create();
+  TargetMachine *TM = builder.selectTarget();
+  if (TM && UseMCJIT && !ForceInterpreter && !ObjectCacheDir.empty())
+    ObjCache = new FileObjectCache(ObjectCacheDir, *TM);
+
+  EE = builder.create(TM);
   if (!EE) {
     if (!ErrorMsg.empty())
       errs() << argv[0] << ": error creating EE: " << ErrorMsg << "\n";
@@ -622,6 +646,11 @@ int main(int argc, char **argv, char * const *envp) {
     NoLazyCompilation = true;
   }
   EE->DisableLazyCompilation(NoLazyCompilation);
+  EE->EnableUnitCompilation(CompileInUnits);
+  EE->setTierUpThreshold(TierUpThreshold);
+
+  if (ObjCache)
+    EE->setObjectCache(ObjCache);
 
   // If the user specifically requested an argv[0] to pass into the program,
   // do it now.
@@ -12,19 +12,25 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "llvm-link"
 #include "llvm/Linker.h"
 #include "llvm/LLVMContext.h"
 #include "llvm/Module.h"
 #include "llvm/Analysis/Verifier.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/SystemUtils.h"
 #include "llvm/Support/IRReader.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/ADT/Statistic.h"
+#include <algorithm>
 #include <memory>
 using namespace llvm;
 
@@ -49,12 +55,16 @@ Verbose("v", cl::desc("Print information about actions taken"));
 static cl::opt<bool>
 DumpAsm("d", cl::desc("Print assembly as linked"), cl::Hidden);
 
+STATISTIC(NumInputs, "Number of input modules linked");
+
 // LoadFile - Read the specified bitcode file in and return it.  This routine
-// searches the link path for the specified file to try to find it...
+// searches the link path for the specified file to try to find it...  If Lazy
+// is true, function bodies are only read when they are linked.
 //
 static inline std::auto_ptr<Module> LoadFile(const char *argv0,
                                              const std::string &FN, 
-                                             LLVMContext& Context) {
+                                             LLVMContext& Context,
+                                             bool Lazy = false) {
   sys::Path Filename;
   if (!Filename.set(FN)) {
     errs() << "Invalid file name: '" << FN << "'\n";
@@ -66,7 +76,10 @@ static inline std::auto_ptr<Module> LoadFile(const char *argv0,
   Module* Result = 0;
   
   const std::string &FNStr = Filename.str();
-  Result = ParseIRFile(FNStr, Err, Context);
+  if (Lazy)
+    Result = getLazyIRFileModule(FNStr, Err, Context);
+  else
+    Result = ParseIRFile(FNStr, Err, Context);
   if (Result) return std::auto_ptr<Module>(Result);   // Load successful!
 
   Err.print(argv0, errs());
@@ -93,9 +106,17 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  // The remaining inputs are read lazily: in DestroySource mode the linker
+  // materializes one function at a time and moves its body into the composite
+  // module, so the source module never holds more than one body.  Each source
+  // module is freed as soon as it has been linked in.
+  unsigned PeakMallocKB = 0;
   for (unsigned i = BaseArg+1; i < InputFilenames.size(); ++i) {
+    TimeRecord Elapsed;
+    Elapsed -= TimeRecord::getCurrentTime(true);
+
     std::auto_ptr<Module> M(LoadFile(argv[0],
-                                     InputFilenames[i], Context));
+                                     InputFilenames[i], Context, true));
     if (M.get() == 0) {
       errs() << argv[0] << ": error loading file '" <<InputFilenames[i]<< "'\n";
       return 1;
@@ -109,7 +130,22 @@ int main(int argc, char **argv) {
              << "': " << ErrorMessage << "\n";
       return 1;
     }
+
+    // Sample the heap while the source module is still alive; that is when
+    // linking this input uses the most memory.
+    unsigned MallocKB = sys::Process::GetMallocUsage() / 1024;
+    PeakMallocKB = std::max(PeakMallocKB, MallocKB);
+    M.reset();
+
+    Elapsed += TimeRecord::getCurrentTime(false);
+    ++NumInputs;
+    if (Verbose)
+      errs() << "Linked '" << InputFilenames[i] << "' in "
+             << format("%.4f", Elapsed.getProcessTime()) << "s, heap usage "
+             << MallocKB << " KB\n";
   }
+  if (Verbose && InputFilenames.size() > BaseArg+1)
+    errs() << "Peak heap usage while linking: " << PeakMallocKB << " KB\n";
 
   // TODO: Iterate over the -l list and link in any modules containing
   // global symbols that have not been resolved so far.
@@ -17,6 +17,7 @@
 
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/DebugInfo/AddressRangeIndex.h"
 #include "llvm/DebugInfo/DIContext.h"
 #include "llvm/Object/MachO.h"
 #include "llvm/Object/ObjectFile.h"
@@ -84,9 +85,15 @@ namespace {
 class ModuleInfo {
   OwningPtr<ObjectFile> Module;
   OwningPtr<DIContext> DebugInfoContext;
+
+  // Function symbols of Module, built on the first lookup so that each
+  // address costs a binary search rather than a walk over the whole symbol
+  // table.
+  mutable AddressRangeIndex<StringRef> Functions;
+  mutable bool FunctionsBuilt;
  public:
   ModuleInfo(ObjectFile *Obj, DIContext *DICtx)
-      : Module(Obj), DebugInfoContext(DICtx) {}
+      : Module(Obj), DebugInfoContext(DICtx), FunctionsBuilt(false) {}
 
   DILineInfo symbolizeCode(uint64_t ModuleOffset) const {
     DILineInfo LineInfo;
@@ -134,33 +141,42 @@ class ModuleInfo {
   }
 
  private:
-  bool getFunctionNameFromSymbolTable(uint64_t Address,
-                                      std::string &FunctionName) const {
+  void buildFunctionIndex() const {
     assert(Module);
+    FunctionsBuilt = true;
     error_code ec;
     for (symbol_iterator si = Module->begin_symbols(),
                          se = Module->end_symbols();
                          si != se; si.increment(ec)) {
-      if (error(ec)) return false;
+      if (error(ec)) break;
       uint64_t SymbolAddress;
       uint64_t SymbolSize;
       SymbolRef::Type SymbolType;
+      if (error(si->getType(SymbolType)) ||
+          SymbolType != SymbolRef::ST_Function) continue;
       if (error(si->getAddress(SymbolAddress)) ||
           SymbolAddress == UnknownAddressOrSize) continue;
       if (error(si->getSize(SymbolSize)) ||
-          SymbolSize == UnknownAddressOrSize) continue;
-      if (error(si->getType(SymbolType))) continue;
-      // FIXME: If a function has alias, there are two entries in symbol table
-      // with same address size. Make sure we choose the correct one.
-      if (SymbolAddress <= Address && Address < SymbolAddress + SymbolSize &&
-          SymbolType == SymbolRef::ST_Function) {
-        StringRef Name;
-        if (error(si->getName(Name))) continue;
-        FunctionName = Name.str();
-        return true;
-      }
+          SymbolSize == UnknownAddressOrSize || SymbolSize == 0) continue;
+      StringRef Name;
+      if (error(si->getName(Name))) continue;
+      Functions.insert(SymbolAddress, SymbolAddress + SymbolSize - 1, Name);
     }
-    return false;
+    Functions.finalize();
+  }
+
+  bool getFunctionNameFromSymbolTable(uint64_t Address,
+                                      std::string &FunctionName) const {
+    if (!FunctionsBuilt)
+      buildFunctionIndex();
+    // A function nested in another one, such as a local entry point, wins
+    // over the one enclosing it. Aliases of a function start at the same
+    // address; the one that comes first in the symbol table wins.
+    const StringRef *Name = Functions.find(Address);
+    if (!Name)
+      return false;
+    FunctionName = Name->str();
+    return true;
   }
 };
 
@@ -34,16 +34,29 @@
 #include "llvm/Target/TargetRegisterInfo.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/InstIterator.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PathV2.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/system_error.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/IntEqClasses.h"
 #include "llvm/ADT/StringExtras.h"
+#include <algorithm>
+#include <cstring>
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#endif
 using namespace llvm;
 
 static cl::opt<bool>
@@ -67,7 +80,7 @@ LTOCodeGenerator::LTOCodeGenerator()
     _linker("LinkTimeOptimizer", "ld-temp.o", _context), _target(NULL),
     _emitDwarfDebugInfo(false), _scopeRestrictionsDone(false),
     _codeModel(LTO_CODEGEN_PIC_MODEL_DYNAMIC),
-    _nativeObjectFile(NULL) {
+    _nativeObjectFile(NULL), _numPartitions(1) {
   InitializeAllTargets();
   InitializeAllTargetMCs();
   InitializeAllAsmPrinters();
@@ -160,6 +173,20 @@ bool LTOCodeGenerator::compile_to_file(const char** name, std::string& errMsg) {
   }
   sys::RemoveFileOnSignal(uniqueObjPath);
 
+  // Reuse the object file of an earlier link of the same program, if any.
+  std::string cachePath;
+  if (!_cacheDir.empty()) {
+    cachePath = getCacheFilePath();
+    bool cached = false;
+    if (!sys::fs::exists(cachePath, cached) && cached &&
+        !sys::fs::copy_file(cachePath, uniqueObjPath.str(),
+                            sys::fs::copy_option::overwrite_if_exists)) {
+      _nativeObjectPath = uniqueObjPath.str();
+      *name = _nativeObjectPath.c_str();
+      return false;
+    }
+  }
+
   // generate object file
   bool genResult = false;
   tool_output_file objFile(uniqueObjPath.c_str(), errMsg);
@@ -184,9 +211,121 @@ bool LTOCodeGenerator::compile_to_file(const char** name, std::string& errMsg) {
 
   _nativeObjectPath = uniqueObjPath.str();
   *name = _nativeObjectPath.c_str();
+
+  // Failing to populate the cache is not an error; the next link just has to
+  // generate the object again.
+  if (!cachePath.empty())
+    storeInCache(cachePath);
   return false;
 }
 
+bool LTOCodeGenerator::compile_to_files(const char ***names,
+                                        unsigned *numFiles,
+                                        std::string &errMsg) {
+  std::vector<std::string> objects;
+  if (this->generateObjectFiles(objects, errMsg))
+    return true;
+
+  // write each object to its own unique temp .o file
+  std::vector<std::string> paths;
+  for (unsigned i = 0, e = objects.size(); i != e; ++i) {
+    sys::PathWithStatus uniqueObjPath("lto-llvm.o");
+    bool failed = uniqueObjPath.createTemporaryFileOnDisk(false, &errMsg);
+    if (!failed) {
+      tool_output_file objFile(uniqueObjPath.c_str(), errMsg,
+                               raw_fd_ostream::F_Binary);
+      failed = !errMsg.empty();
+      if (!failed) {
+        objFile.os() << objects[i];
+        objFile.os().close();
+        if (objFile.os().has_error()) {
+          objFile.os().clear_error();
+          errMsg = "could not write object file: " + uniqueObjPath.str();
+          failed = true;
+        } else {
+          objFile.keep();
+        }
+      }
+    }
+    if (failed) {
+      uniqueObjPath.eraseFromDisk();
+      for (unsigned j = 0, je = paths.size(); j != je; ++j)
+        sys::Path(paths[j]).eraseFromDisk();
+      return true;
+    }
+    paths.push_back(uniqueObjPath.str());
+  }
+
+  _nativeObjectPaths.swap(paths);
+  _nativeObjectNames.clear();
+  for (unsigned i = 0, e = _nativeObjectPaths.size(); i != e; ++i)
+    _nativeObjectNames.push_back(_nativeObjectPaths[i].c_str());
+  *names = &_nativeObjectNames[0];
+  *numFiles = _nativeObjectNames.size();
+  return false;
+}
+
+/// getCacheFilePath - Return the path of the cache entry for the merged
+/// module.  The key covers the bitcode of the merged module as it is before
+/// internalization and optimization, together with everything else that
+/// affects the generated code: the symbols that must be preserved, the
+/// target, the PIC and debug models and the code generator options.
+std::string LTOCodeGenerator::getCacheFilePath() {
+  std::string bitcode;
+  {
+    raw_string_ostream os(bitcode);
+    WriteBitcodeToFile(_linker.getModule(), os);
+  }
+
+  std::string config;
+  {
+    raw_string_ostream os(config);
+    os << getVersionString() << '|' << _linker.getModule()->getTargetTriple()
+       << '|' << _mCpu << '|' << _codeModel << '|' << _emitDwarfDebugInfo;
+
+    // StringMap iteration order depends on the insertion history, so sort the
+    // symbols to get the same key for the same set.
+    std::vector<StringRef> symbols;
+    for (StringSet::iterator I = _mustPreserveSymbols.begin(),
+           E = _mustPreserveSymbols.end(); I != E; ++I)
+      symbols.push_back(I->getKey());
+    std::sort(symbols.begin(), symbols.end());
+    for (unsigned i = 0, e = symbols.size(); i != e; ++i)
+      os << '|' << symbols[i];
+
+    for (unsigned i = 0, e = _codegenOptions.size(); i != e; ++i)
+      os << '|' << _codegenOptions[i];
+  }
+
+  uint64_t hash = HashString64(config);
+  hash = HashString64(bitcode, hash);
+
+  SmallString<128> path(_cacheDir);
+  sys::path::append(path, "lto-" + utohexstr(hash) + "-" +
+                    utostr(bitcode.size()) + ".o");
+  return path.str();
+}
+
+/// storeInCache - Copy the object file just generated into the cache entry
+/// at cachePath.
+void LTOCodeGenerator::storeInCache(StringRef cachePath) {
+  bool existed;
+  if (sys::fs::create_directories(_cacheDir, existed))
+    return;
+
+  OwningPtr<MemoryBuffer> obj;
+  if (MemoryBuffer::getFile(_nativeObjectPath, obj, -1, false))
+    return;
+
+  // FileOutputBuffer writes to a temporary file and renames it over the entry
+  // on commit, so concurrent links either see the whole object or nothing.
+  OwningPtr<FileOutputBuffer> out;
+  if (FileOutputBuffer::create(cachePath, obj->getBufferSize(), out))
+    return;
+  memcpy(out->getBufferStart(), obj->getBufferStart(), obj->getBufferSize());
+  out->commit();
+}
+
 const void* LTOCodeGenerator::compile(size_t* length, std::string& errMsg) {
   const char *name;
   if (compile_to_file(&name, errMsg))
@@ -348,8 +487,7 @@ void LTOCodeGenerator::applyScopeRestrictions() {
 }
 
 /// Optimize merged modules using various IPO passes
-bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
-                                          std::string &errMsg) {
+bool LTOCodeGenerator::optimize(std::string &errMsg) {
   if (this->determineTarget(errMsg))
     return true;
 
@@ -384,6 +522,18 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   // Make sure everything is still good.
   passes.add(createVerifierPass());
 
+  // Run our queue of passes all at once now, efficiently.
+  passes.run(*mergedModule);
+  return false;
+}
+
+bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
+                                          std::string &errMsg) {
+  if (this->optimize(errMsg))
+    return true;
+
+  Module* mergedModule = _linker.getModule();
+
   FunctionPassManager *codeGenPasses = new FunctionPassManager(mergedModule);
 
   codeGenPasses->add(new DataLayout(*_target->getDataLayout()));
@@ -393,12 +543,10 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   if (_target->addPassesToEmitFile(*codeGenPasses, Out,
                                    TargetMachine::CGFT_ObjectFile)) {
     errMsg = "target file type not supported";
+    delete codeGenPasses;
     return true;
   }
 
-  // Run our queue of passes all at once now, efficiently.
-  passes.run(*mergedModule);
-
   // Run the code generator, and write assembly file
   codeGenPasses->doInitialization();
 
@@ -413,6 +561,352 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   return false; // success
 }
 
+namespace {
+  /// PartitionJob - The input and output of the code generation of one
+  /// partition.  Each job runs in its own LLVMContext, so jobs can run on
+  /// different threads.
+  struct PartitionJob {
+    const TargetMachine *Target;
+    std::string Bitcode;
+    std::string Object;
+    std::string Error;
+  };
+
+  /// ReferenceCollector - Collects the global values a function, variable
+  /// or alias refers to, directly or through constant expressions.
+  struct ReferenceCollector {
+    SmallPtrSet<const Constant*, 32> Visited;
+    SmallVector<const GlobalValue*, 16> Refs;
+    SmallVector<const Function*, 2> BlockAddressFns;
+
+    void walk(const Constant *C) {
+      if (!Visited.insert(C))
+        return;
+      if (const GlobalValue *GV = dyn_cast<GlobalValue>(C)) {
+        Refs.push_back(GV);
+        return;
+      }
+      if (const BlockAddress *BA = dyn_cast<BlockAddress>(C))
+        BlockAddressFns.push_back(BA->getFunction());
+      for (User::const_op_iterator I = C->op_begin(), E = C->op_end();
+           I != E; ++I)
+        if (const Constant *Op = dyn_cast<Constant>(*I))
+          walk(Op);
+    }
+
+    void walk(const GlobalValue &GV) {
+      if (const Function *F = dyn_cast<Function>(&GV)) {
+        for (const_inst_iterator I = inst_begin(F), E = inst_end(F); I != E;
+             ++I)
+          for (User::const_op_iterator OI = I->op_begin(), OE = I->op_end();
+               OI != OE; ++OI)
+            if (const Constant *C = dyn_cast<Constant>(*OI))
+              walk(C);
+      } else if (const GlobalVariable *GVar = dyn_cast<GlobalVariable>(&GV)) {
+        if (GVar->hasInitializer())
+          walk(GVar->getInitializer());
+      } else {
+        walk(cast<GlobalAlias>(GV).getAliasee());
+      }
+    }
+  };
+
+  /// MoreWork - Orders clusters by decreasing size, then by position.
+  struct MoreWork {
+    const std::vector<uint64_t> &Sizes;
+    MoreWork(const std::vector<uint64_t> &Sizes) : Sizes(Sizes) {}
+    bool operator()(unsigned LHS, unsigned RHS) const {
+      if (Sizes[LHS] != Sizes[RHS])
+        return Sizes[LHS] > Sizes[RHS];
+      return LHS < RHS;
+    }
+  };
+}
+
+/// isPartitioned - Return true if GV is placed in exactly one partition:
+/// definitions that are emitted, and the appending variables, which are
+/// kept together.  Everything else is left in every partition.
+static bool isPartitioned(const GlobalValue &GV) {
+  return !GV.isDeclaration() && !GV.hasAvailableExternallyLinkage();
+}
+
+/// codegenPartition - Generate the object file of one partition.
+static void codegenPartition(PartitionJob &Job) {
+  LLVMContext Context;
+  OwningPtr<MemoryBuffer> Buffer(MemoryBuffer::getMemBuffer(Job.Bitcode, "",
+                                                            false));
+  OwningPtr<Module> M(ParseBitcodeFile(Buffer.get(), Context, &Job.Error));
+  if (!M)
+    return;
+
+  const TargetMachine &TM = *Job.Target;
+  OwningPtr<TargetMachine> Target(
+    TM.getTarget().createTargetMachine(TM.getTargetTriple(),
+                                       TM.getTargetCPU(),
+                                       TM.getTargetFeatureString(),
+                                       TM.Options, TM.getRelocationModel(),
+                                       TM.getCodeModel(), TM.getOptLevel()));
+
+  PassManager codeGenPasses;
+  codeGenPasses.add(new DataLayout(*Target->getDataLayout()));
+
+  raw_string_ostream OS(Job.Object);
+  formatted_raw_ostream Out(OS);
+  if (Target->addPassesToEmitFile(codeGenPasses, Out,
+                                  TargetMachine::CGFT_ObjectFile)) {
+    Job.Error = "target file type not supported";
+    return;
+  }
+  codeGenPasses.run(*M);
+}
+
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+static void *codegenPartitionThread(void *Arg) {
+  codegenPartition(*static_cast<PartitionJob*>(Arg));
+  return 0;
+}
+#endif
+
+/// runPartitionJobs - Generate the objects of all partitions, each on its own
+/// thread if LLVM was built with threads.
+static void runPartitionJobs(std::vector<PartitionJob> &Jobs) {
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+  if (Jobs.size() > 1 &&
+      (llvm_is_multithreaded() || llvm_start_multithreaded())) {
+    std::vector<pthread_t> Threads(Jobs.size());
+    std::vector<bool> Started(Jobs.size());
+    for (unsigned i = 0, e = Jobs.size(); i != e; ++i)
+      Started[i] = !::pthread_create(&Threads[i], 0, codegenPartitionThread,
+                                     &Jobs[i]);
+    // Jobs whose thread could not be created run here.
+    for (unsigned i = 0, e = Jobs.size(); i != e; ++i) {
+      if (Started[i])
+        ::pthread_join(Threads[i], 0);
+      else
+        codegenPartition(Jobs[i]);
+    }
+    return;
+  }
+#endif
+  for (unsigned i = 0, e = Jobs.size(); i != e; ++i)
+    codegenPartition(Jobs[i]);
+}
+
+/// splitModule - Split the optimized module M into at most NumPartitions
+/// partitions and write each one to Jobs as bitcode.
+///
+/// A local value with a single user is kept with that user, so helpers stay
+/// with their only caller; the remaining clusters are assigned, largest
+/// first, to the least loaded partition.  Local values used from another
+/// partition are renamed and promoted to hidden external symbols.  Only the
+/// module's contents decide the split, so the output is deterministic.
+static void splitModule(Module *M, unsigned NumPartitions,
+                        const TargetMachine *Target,
+                        std::vector<PartitionJob> &Jobs) {
+
+  // Number the partitioned values in module order.
+  std::vector<GlobalValue*> Values;
+  DenseMap<const GlobalValue*, unsigned> ValueIds;
+  for (Module::iterator I = M->begin(), E = M->end();
+       I != E; ++I)
+    if (isPartitioned(*I)) {
+      ValueIds[I] = Values.size();
+      Values.push_back(I);
+    }
+  for (Module::global_iterator I = M->global_begin(),
+         E = M->global_end(); I != E; ++I)
+    if (isPartitioned(*I)) {
+      ValueIds[I] = Values.size();
+      Values.push_back(I);
+    }
+  for (Module::alias_iterator I = M->alias_begin(),
+         E = M->alias_end(); I != E; ++I) {
+    ValueIds[I] = Values.size();
+    Values.push_back(I);
+  }
+
+  // Record which partitioned values each value refers to and how many values
+  // refer to each one.  Values that must stay together are joined: aliases
+  // with their aliasees, functions with the users of their block addresses,
+  // and all of the appending variables.
+  unsigned NumValues = Values.size();
+  std::vector<SmallVector<unsigned, 8> > Refs(NumValues);
+  std::vector<unsigned> NumUsers(NumValues), OnlyUser(NumValues);
+  std::vector<uint64_t> Sizes(NumValues, 1);
+  IntEqClasses Clusters(NumValues);
+  unsigned FirstAppending = NumValues;
+  for (unsigned i = 0; i != NumValues; ++i) {
+    GlobalValue *GV = Values[i];
+    if (const Function *F = dyn_cast<Function>(GV)) {
+      Sizes[i] = 0;
+      for (Function::const_iterator BB = F->begin(), E = F->end(); BB != E;
+           ++BB)
+        Sizes[i] += BB->size();
+    } else if (GV->hasAppendingLinkage()) {
+      if (FirstAppending == NumValues)
+        FirstAppending = i;
+      Clusters.join(FirstAppending, i);
+    } else if (GlobalAlias *GA = dyn_cast<GlobalAlias>(GV)) {
+      DenseMap<const GlobalValue*, unsigned>::iterator Aliasee =
+        ValueIds.find(GA->getAliasedGlobal());
+      if (Aliasee != ValueIds.end())
+        Clusters.join(i, Aliasee->second);
+    }
+
+    ReferenceCollector Collector;
+    Collector.walk(*GV);
+    for (unsigned j = 0, e = Collector.Refs.size(); j != e; ++j) {
+      DenseMap<const GlobalValue*, unsigned>::iterator Ref =
+        ValueIds.find(Collector.Refs[j]);
+      if (Ref == ValueIds.end() || Ref->second == i)
+        continue;
+      Refs[i].push_back(Ref->second);
+      ++NumUsers[Ref->second];
+      OnlyUser[Ref->second] = i;
+    }
+    for (unsigned j = 0, e = Collector.BlockAddressFns.size(); j != e; ++j) {
+      DenseMap<const GlobalValue*, unsigned>::iterator Ref =
+        ValueIds.find(Collector.BlockAddressFns[j]);
+      if (Ref != ValueIds.end())
+        Clusters.join(i, Ref->second);
+    }
+  }
+  for (unsigned i = 0; i != NumValues; ++i)
+    if (NumUsers[i] == 1 && Values[i]->hasLocalLinkage())
+      Clusters.join(i, OnlyUser[i]);
+  Clusters.compress();
+
+  // Assign the clusters, largest first, to the least loaded partition.
+  unsigned NumClusters = Clusters.getNumClasses();
+  std::vector<uint64_t> ClusterSizes(NumClusters);
+  for (unsigned i = 0; i != NumValues; ++i)
+    ClusterSizes[Clusters[i]] += Sizes[i];
+  std::vector<unsigned> Order(NumClusters);
+  for (unsigned i = 0; i != NumClusters; ++i)
+    Order[i] = i;
+  std::sort(Order.begin(), Order.end(), MoreWork(ClusterSizes));
+
+  NumPartitions = std::min(NumPartitions, std::max(NumClusters, 1U));
+  std::vector<uint64_t> Loads(NumPartitions);
+  std::vector<unsigned> ClusterPartition(NumClusters);
+  for (unsigned i = 0; i != NumClusters; ++i) {
+    unsigned Least = std::min_element(Loads.begin(), Loads.end()) -
+                     Loads.begin();
+    ClusterPartition[Order[i]] = Least;
+    Loads[Least] += ClusterSizes[Order[i]];
+  }
+  std::vector<unsigned> Partition(NumValues);
+  for (unsigned i = 0; i != NumValues; ++i)
+    Partition[i] = ClusterPartition[Clusters[i]];
+
+  // Promote the local values used from another partition.  The new names
+  // only need to be unique within the merged module, which is linked into a
+  // single image.
+  unsigned NumPromoted = 0;
+  std::vector<bool> Promote(NumValues);
+  for (unsigned i = 0; i != NumValues; ++i)
+    for (unsigned j = 0, e = Refs[i].size(); j != e; ++j)
+      if (Partition[Refs[i][j]] != Partition[i])
+        Promote[Refs[i][j]] = true;
+  for (unsigned i = 0; i != NumValues; ++i) {
+    GlobalValue *GV = Values[i];
+    if (!Promote[i] || !GV->hasLocalLinkage())
+      continue;
+    std::string Name = GV->hasName() ? GV->getName().str() + ".lto_priv."
+                                     : std::string("__lto_priv.");
+    GV->setName(Name + utostr(NumPromoted++));
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+    GV->setVisibility(GlobalValue::HiddenVisibility);
+  }
+
+  // Write each partition: a copy of the module with the values of the other
+  // partitions turned into declarations.
+  Jobs.resize(NumPartitions);
+  for (unsigned p = 0; p != NumPartitions; ++p) {
+    ValueToValueMapTy VMap;
+    OwningPtr<Module> Part(CloneModule(M, VMap));
+
+    std::vector<GlobalValue*> Dropped;
+    for (unsigned i = 0; i != NumValues; ++i) {
+      if (Partition[i] == p)
+        continue;
+      GlobalValue *GV = cast<GlobalValue>(VMap[Values[i]]);
+      Dropped.push_back(GV);
+      if (Function *F = dyn_cast<Function>(GV)) {
+        F->deleteBody();
+      } else if (GlobalVariable *GVar = dyn_cast<GlobalVariable>(GV)) {
+        GVar->setInitializer(0);
+        GVar->setLinkage(GlobalValue::ExternalLinkage);
+      } else {
+        // An alias cannot be a declaration; use a function or variable.
+        GlobalAlias *GA = cast<GlobalAlias>(GV);
+        Type *Ty = GA->getType()->getElementType();
+        GlobalValue *Decl;
+        if (FunctionType *FTy = dyn_cast<FunctionType>(Ty))
+          Decl = Function::Create(FTy, GlobalValue::ExternalLinkage, "",
+                                  Part.get());
+        else
+          Decl = new GlobalVariable(*Part, Ty, false,
+                                    GlobalValue::ExternalLinkage, 0, "", 0,
+                                    GlobalVariable::NotThreadLocal,
+                                    GA->getType()->getAddressSpace());
+        Decl->takeName(GA);
+        Decl->setVisibility(GA->getVisibility());
+        GA->replaceAllUsesWith(ConstantExpr::getBitCast(Decl, GA->getType()));
+        GA->eraseFromParent();
+        Dropped.back() = Decl;
+      }
+    }
+
+    // Remove the declarations nothing in this partition refers to; the
+    // appending variables are never referred to.
+    for (unsigned i = 0, e = Dropped.size(); i != e; ++i) {
+      GlobalValue *GV = Dropped[i];
+      GV->removeDeadConstantUsers();
+      if (GV->use_empty())
+        GV->eraseFromParent();
+    }
+    if (p != 0)
+      Part->setModuleInlineAsm("");
+
+    raw_string_ostream OS(Jobs[p].Bitcode);
+    WriteBitcodeToFile(Part.get(), OS);
+    OS.flush();
+    Jobs[p].Target = Target;
+  }
+}
+
+/// generateObjectFiles - Optimize the merged modules, split them and
+/// generate one object file per partition.
+bool LTOCodeGenerator::generateObjectFiles(std::vector<std::string> &objects,
+                                           std::string &errMsg) {
+  if (this->optimize(errMsg))
+    return true;
+
+  // Debug info and module level asm may refer to local symbols of any
+  // partition, so such modules are generated as a whole.
+  Module *mergedModule = _linker.getModule();
+  unsigned numPartitions = _numPartitions;
+  if (mergedModule->getNamedMetadata("llvm.dbg.cu") ||
+      !mergedModule->getModuleInlineAsm().empty())
+    numPartitions = 1;
+
+  std::vector<PartitionJob> jobs;
+  splitModule(mergedModule, numPartitions, _target, jobs);
+
+  runPartitionJobs(jobs);
+
+  objects.clear();
+  for (unsigned i = 0, e = jobs.size(); i != e; ++i) {
+    if (!jobs[i].Error.empty()) {
+      errMsg = jobs[i].Error;
+      return true;
+    }
+    objects.push_back(jobs[i].Object);
+  }
+  return false;
+}
+
 /// setCodeGenDebugOptions - Set codegen debugging options to aid in debugging
 /// LTO problems.
 void LTOCodeGenerator::setCodeGenDebugOptions(const char *options) {
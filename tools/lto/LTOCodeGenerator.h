@@ -19,6 +19,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm-c/lto.h"
 #include <string>
+#include <vector>
 
 namespace llvm {
   class LLVMContext;
@@ -44,6 +45,8 @@ struct LTOCodeGenerator {
   bool setCodePICModel(lto_codegen_model, std::string &errMsg);
 
   void setCpu(const char* mCpu) { _mCpu = mCpu; }
+  void setCacheDir(const char* dir) { _cacheDir = dir ? dir : ""; }
+  void setNumPartitions(unsigned num) { _numPartitions = num ? num : 1; }
 
   void addMustPreserveSymbol(const char* sym) {
     _mustPreserveSymbols[sym] = 1;
@@ -51,17 +54,24 @@ struct LTOCodeGenerator {
 
   bool writeMergedModules(const char *path, std::string &errMsg);
   bool compile_to_file(const char **name, std::string &errMsg);
+  bool compile_to_files(const char ***names, unsigned *numFiles,
+                        std::string &errMsg);
   const void *compile(size_t *length, std::string &errMsg);
   void setCodeGenDebugOptions(const char *opts);
 
 private:
+  bool optimize(std::string &errMsg);
   bool generateObjectFile(llvm::raw_ostream &out, std::string &errMsg);
+  bool generateObjectFiles(std::vector<std::string> &objects,
+                           std::string &errMsg);
   void applyScopeRestrictions();
   void applyRestriction(llvm::GlobalValue &GV,
                         std::vector<const char*> &mustPreserveList,
                         llvm::SmallPtrSet<llvm::GlobalValue*, 8> &asmUsed,
                         llvm::Mangler &mangler);
   bool determineTarget(std::string &errMsg);
+  std::string getCacheFilePath();
+  void storeInCache(llvm::StringRef cachePath);
 
   typedef llvm::StringMap<uint8_t> StringSet;
 
@@ -77,6 +87,10 @@ private:
   std::vector<char*>          _codegenOptions;
   std::string                 _mCpu;
   std::string                 _nativeObjectPath;
+  std::string                 _cacheDir;
+  unsigned                    _numPartitions;
+  std::vector<std::string>    _nativeObjectPaths;
+  std::vector<const char*>    _nativeObjectNames;
 };
 
 #endif // LTO_CODE_GENERATOR_H
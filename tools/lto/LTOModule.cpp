@@ -28,7 +28,9 @@
 #include "llvm/Target/TargetRegisterInfo.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
@@ -200,8 +202,10 @@ bool LTOModule::isTargetMatch(MemoryBuffer *buffer, const char *triplePrefix) {
 /// makeLTOModule - Create an LTOModule. N.B. These methods take ownership of
 /// the buffer.
 LTOModule *LTOModule::makeLTOModule(const char *path, std::string &errMsg) {
+  // Bitcode doesn't need a null terminator, which lets large files be mapped
+  // rather than copied.
   OwningPtr<MemoryBuffer> buffer;
-  if (error_code ec = MemoryBuffer::getFile(path, buffer)) {
+  if (error_code ec = MemoryBuffer::getFile(path, buffer, -1, false)) {
     errMsg = ec.message();
     return NULL;
   }
@@ -270,9 +274,10 @@ LTOModule *LTOModule::makeLTOModule(MemoryBuffer *buffer,
     Initialized = true;
   }
 
-  // parse bitcode buffer
+  // parse bitcode buffer.  Scanning the symbols needs neither the function
+  // bodies nor the metadata, so both are read on demand.
   OwningPtr<Module> m(getLazyBitcodeModule(buffer, getGlobalContext(),
-                                           &errMsg));
+                                           &errMsg, true));
   if (!m) {
     delete buffer;
     return NULL;
@@ -281,6 +286,49 @@ LTOModule *LTOModule::makeLTOModule(MemoryBuffer *buffer,
   std::string TripleStr = m->getTargetTriple();
   if (TripleStr.empty())
     TripleStr = sys::getDefaultTargetTriple();
+
+  TargetMachine *target = getScanTarget(TripleStr, errMsg);
+  if (!target)
+    return NULL;
+
+  // construct LTOModule, hand over ownership of module
+  LTOModule *Ret = new LTOModule(m.take(), target);
+  if (Ret->parseSymbols(errMsg)) {
+    delete Ret;
+    return NULL;
+  }
+
+  return Ret;
+}
+
+namespace {
+  /// ScanTargetMap - Owns the target machines handed out by getScanTarget.
+  struct ScanTargetMap : public StringMap<TargetMachine*> {
+    ~ScanTargetMap() {
+      for (iterator I = begin(), E = end(); I != E; ++I)
+        delete I->getValue();
+    }
+  };
+}
+
+static ManagedStatic<ScanTargetMap> ScanTargets;
+static ManagedStatic<sys::SmartMutex<true> > ScanTargetsLock;
+
+/// getScanTarget - Return the TargetMachine used to scan the symbols of
+/// modules for the specified triple.  Linkers create a module for every
+/// bitcode archive member they look at, and building a TargetMachine costs far
+/// more than reading the symbol table of a typical member, so one machine per
+/// triple is created and shared.  It is only used for mangling names and
+/// parsing module-level asm, never for generating code, so it does not matter
+/// that the target options are those in effect when it was created.  Linkers
+/// may create modules on several threads, so the map is guarded by a lock.
+TargetMachine *LTOModule::getScanTarget(const std::string &TripleStr,
+                                        std::string &errMsg) {
+  sys::SmartScopedLock<true> Lock(*ScanTargetsLock);
+  TargetMachine *&target = (*ScanTargets)[TripleStr];
+  if (target)
+    return target;
+
   llvm::Triple Triple(TripleStr);
 
   // find machine architecture for this module
@@ -288,7 +336,6 @@ LTOModule *LTOModule::makeLTOModule(MemoryBuffer *buffer,
   if (!march)
     return NULL;
 
-  // construct LTOModule, hand over ownership of module and target
   SubtargetFeatures Features;
   Features.getDefaultSubtargetFeatures(Triple);
   std::string FeatureStr = Features.getString();
@@ -302,15 +349,8 @@ LTOModule *LTOModule::makeLTOModule(MemoryBuffer *buffer,
   }
   TargetOptions Options;
   getTargetOptions(Options);
-  TargetMachine *target = march->createTargetMachine(TripleStr, CPU, FeatureStr,
-                                                     Options);
-  LTOModule *Ret = new LTOModule(m.take(), target);
-  if (Ret->parseSymbols(errMsg)) {
-    delete Ret;
-    return NULL;
-  }
-
-  return Ret;
+  target = march->createTargetMachine(TripleStr, CPU, FeatureStr, Options);
+  return target;
 }
 
 /// makeBuffer - Create a MemoryBuffer from a memory range.
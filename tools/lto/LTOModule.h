@@ -48,7 +48,10 @@ private:
   };
 
   llvm::OwningPtr<llvm::Module>           _module;
-  llvm::OwningPtr<llvm::TargetMachine>    _target;
+  // Not owned.  The scan target for the module's triple is shared by all
+  // modules for that triple and owned by getScanTarget(), which keeps it
+  // until llvm_shutdown().  Modules only read from it.
+  llvm::TargetMachine                    *_target;
   std::vector<NameAndAttributes>          _symbols;
 
   // _defines and _undefines only needed to disambiguate tentative definitions
@@ -179,6 +182,11 @@ private:
   static bool isTargetMatch(llvm::MemoryBuffer *memBuffer,
                             const char *triplePrefix);
 
+  /// getScanTarget - Return the TargetMachine used to scan the symbols of
+  /// modules for the specified triple, creating it on first use.
+  static llvm::TargetMachine *getScanTarget(const std::string &triple,
+                                            std::string &errMsg);
+
   /// makeLTOModule - Create an LTOModule (private version). N.B. This
   /// method takes ownership of the buffer.
   static LTOModule *makeLTOModule(llvm::MemoryBuffer *buffer,
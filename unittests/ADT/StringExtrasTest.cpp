@@ -0,0 +1,28 @@
+//===- llvm/unittest/ADT/StringExtrasTest.cpp -----------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/StringExtras.h"
+
+using namespace llvm;
+
+namespace {
+
+TEST(StringExtrasTest, HashString64) {
+  // Keys of on-disk caches depend on these values; they are the published
+  // FNV-1a test vectors and must not change.
+  EXPECT_EQ(0xcbf29ce484222325ULL, HashString64(""));
+  EXPECT_EQ(0xaf63dc4c8601ec8cULL, HashString64("a"));
+  EXPECT_EQ(0x85944171f73967e8ULL, HashString64("foobar"));
+
+  // Hashing in pieces gives the same value as hashing the concatenation.
+  EXPECT_EQ(HashString64("foobar"), HashString64("bar", HashString64("foo")));
+}
+
+}
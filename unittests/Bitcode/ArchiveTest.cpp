@@ -0,0 +1,102 @@
+//===- llvm/unittest/Bitcode/ArchiveTest.cpp - Tests for Archive ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/Archive.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+namespace llvm {
+namespace {
+
+class ArchiveTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    std::string ErrMsg;
+    TempDir = sys::Path::GetTemporaryDirectory(&ErrMsg);
+    ASSERT_TRUE(ErrMsg.empty()) << ErrMsg;
+  }
+
+  virtual void TearDown() {
+    TempDir.eraseFromDisk(true);
+  }
+
+  /// writeMember - Write a bitcode file defining the functions f<N> and g<N>
+  /// and return its path.
+  sys::Path writeMember(unsigned N) {
+    LLVMContext Context;
+    Module M("member" + utostr(N), Context);
+    FunctionType *FTy = FunctionType::get(Type::getVoidTy(Context), false);
+    const char *Prefixes[] = { "f", "g" };
+    for (unsigned i = 0; i != 2; ++i) {
+      Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                     Prefixes[i] + utostr(N), &M);
+      ReturnInst::Create(Context, BasicBlock::Create(Context, "entry", F));
+    }
+
+    sys::Path Path(TempDir);
+    Path.appendComponent("m" + utostr(N) + ".bc");
+    std::string ErrorInfo;
+    raw_fd_ostream OS(Path.c_str(), ErrorInfo, raw_fd_ostream::F_Binary);
+    EXPECT_TRUE(ErrorInfo.empty()) << ErrorInfo;
+    WriteBitcodeToFile(&M, OS);
+    return Path;
+  }
+
+  sys::Path TempDir;
+};
+
+TEST_F(ArchiveTest, FindModuleDefiningSymbolManyMembers) {
+  const unsigned NumMembers = 500;
+  sys::Path ArchivePath(TempDir);
+  ArchivePath.appendComponent("lib.a");
+
+  {
+    LLVMContext Context;
+    OwningPtr<Archive> Ar(Archive::CreateEmpty(ArchivePath, Context));
+    std::string ErrMsg;
+    for (unsigned i = 0; i != NumMembers; ++i)
+      ASSERT_FALSE(Ar->addFileBefore(writeMember(i), Ar->end(), &ErrMsg))
+        << ErrMsg;
+    ASSERT_FALSE(Ar->writeToDisk(true, false, &ErrMsg)) << ErrMsg;
+  }
+
+  LLVMContext Context;
+  std::string ErrMsg;
+  OwningPtr<Archive> Ar(Archive::OpenAndLoadSymbols(ArchivePath, Context,
+                                                    &ErrMsg));
+  ASSERT_TRUE(Ar.get() != 0) << ErrMsg;
+
+  // Look the symbols up in an order unrelated to the members, so each lookup
+  // has to go through the symbol table.
+  for (unsigned j = 0; j != NumMembers; ++j) {
+    unsigned i = (j * 7) % NumMembers;
+    Module *F = Ar->findModuleDefiningSymbol("f" + utostr(i), &ErrMsg);
+    ASSERT_TRUE(F != 0) << "f" << i << ": " << ErrMsg;
+    // Each member is the only one that has a function named f<i>.
+    EXPECT_TRUE(F->getFunction("f" + utostr(i)) != 0);
+    Module *G = Ar->findModuleDefiningSymbol("g" + utostr(i), &ErrMsg);
+    EXPECT_EQ(F, G);
+  }
+
+  EXPECT_TRUE(Ar->findModuleDefiningSymbol("f" + utostr(NumMembers),
+                                           &ErrMsg) == 0);
+  EXPECT_TRUE(Ar->findModuleDefiningSymbol("", &ErrMsg) == 0);
+}
+
+}
+}
@@ -7,13 +7,16 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/Verifier.h"
 #include "llvm/Bitcode/BitstreamWriter.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/Constants.h"
 #include "llvm/Instructions.h"
 #include "llvm/LLVMContext.h"
+#include "llvm/Metadata.h"
 #include "llvm/Module.h"
 #include "llvm/PassManager.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -61,5 +64,105 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddr) { // PR11677
   passes.run(*m);
 }
 
+static Module *makeModuleWithMetadata() {
+  LLVMContext &Context = getGlobalContext();
+  Module *Mod = new Module("test-metadata", Context);
+
+  FunctionType *FuncTy = FunctionType::get(Type::getVoidTy(Context), false);
+  Function *Func = Function::Create(FuncTy, GlobalValue::ExternalLinkage,
+                                    "func", Mod);
+  BasicBlock *Entry = BasicBlock::Create(Context, "entry", Func);
+  ReturnInst *Ret = ReturnInst::Create(Context, Entry);
+
+  Value *Str = MDString::get(Context, "payload");
+  MDNode *Node = MDNode::get(Context, Str);
+  Mod->getOrInsertNamedMetadata("test.named")->addOperand(Node);
+  Ret->setMetadata("test.kind", Node);
+
+  return Mod;
+}
+
+TEST(BitReaderTest, LazyMetadata) {
+  SmallString<1024> Mem;
+  {
+    OwningPtr<Module> Mod(makeModuleWithMetadata());
+    raw_svector_ostream OS(Mem);
+    WriteBitcodeToFile(Mod.get(), OS);
+  }
+
+  MemoryBuffer *Buffer = MemoryBuffer::getMemBuffer(Mem.str(), "test", false);
+  std::string errMsg;
+  OwningPtr<Module> m(getLazyBitcodeModule(Buffer, getGlobalContext(),
+                                           &errMsg, true));
+  ASSERT_TRUE(m.get() != 0) << errMsg;
+
+  // Nothing but the symbols has been read yet.
+  EXPECT_TRUE(m->getNamedMetadata("test.named") == 0);
+
+  // Reading a function body reads the metadata it refers to first.
+  Function *F = m->getFunction("func");
+  ASSERT_FALSE(F->Materialize(&errMsg)) << errMsg;
+  NamedMDNode *Named = m->getNamedMetadata("test.named");
+  ASSERT_TRUE(Named != 0);
+  ASSERT_EQ(1U, Named->getNumOperands());
+
+  Instruction *Ret = F->getEntryBlock().getTerminator();
+  EXPECT_EQ(Named->getOperand(0), Ret->getMetadata("test.kind"));
+}
+
+static Module *makeModuleWithCalls() {
+  LLVMContext &Context = getGlobalContext();
+  Module *Mod = new Module("test-calls", Context);
+
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  FunctionType *FuncTy = FunctionType::get(Int32Ty, false);
+  Function *Prev = 0;
+  for (unsigned i = 0; i != 4; ++i) {
+    Function *Func = Function::Create(FuncTy, GlobalValue::ExternalLinkage,
+                                      "func" + utostr(i), Mod);
+    BasicBlock *Entry = BasicBlock::Create(Context, "entry", Func);
+    Value *Ret = ConstantInt::get(Int32Ty, i);
+    if (Prev)
+      Ret = CallInst::Create(Prev, "", Entry);
+    ReturnInst::Create(Context, Ret, Entry);
+    Prev = Func;
+  }
+  return Mod;
+}
+
+TEST(BitReaderTest, MaterializeAllAfterSingleFunction) {
+  SmallString<1024> Mem;
+  {
+    OwningPtr<Module> Mod(makeModuleWithCalls());
+    raw_svector_ostream OS(Mem);
+    WriteBitcodeToFile(Mod.get(), OS);
+  }
+
+  MemoryBuffer *Buffer = MemoryBuffer::getMemBuffer(Mem.str(), "test", false);
+  std::string errMsg;
+  OwningPtr<Module> m(getLazyBitcodeModule(Buffer, getGlobalContext(),
+                                           &errMsg));
+  ASSERT_TRUE(m.get() != 0) << errMsg;
+
+  // Read one body on its own, then the rest of the module around it.
+  ASSERT_FALSE(m->getFunction("func2")->Materialize(&errMsg)) << errMsg;
+  ASSERT_FALSE(m->MaterializeAll(&errMsg)) << errMsg;
+
+  for (unsigned i = 0; i != 4; ++i) {
+    Function *F = m->getFunction("func" + utostr(i));
+    ASSERT_FALSE(F->isDeclaration());
+    Instruction *First = F->getEntryBlock().begin();
+    if (i == 0) {
+      EXPECT_TRUE(isa<ReturnInst>(First));
+      continue;
+    }
+    CallInst *Call = dyn_cast<CallInst>(First);
+    ASSERT_TRUE(Call != 0);
+    EXPECT_EQ(m->getFunction("func" + utostr(i - 1)),
+              Call->getCalledFunction());
+  }
+  EXPECT_FALSE(verifyModule(*m, ReturnStatusAction));
+}
+
 }
 }
@@ -0,0 +1,150 @@
+//===- llvm/unittest/CodeGen/SlotIndexesTest.cpp - SlotIndexes tests ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/SlotIndexes.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineInstrBuilder.h"
+#include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Function.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetInstrInfo.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/Target/TargetRegisterInfo.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+class SlotIndexesTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    if (InitializeNativeTarget())
+      return;
+    std::string Error;
+    std::string Triple = sys::getDefaultTargetTriple();
+    const Target *T = TargetRegistry::lookupTarget(Triple, Error);
+    if (!T)
+      return;
+    TM.reset(T->createTargetMachine(Triple, "", "", TargetOptions()));
+    if (!TM)
+      return;
+
+    M.reset(new Module("slot-indexes-test", Context));
+    F = Function::Create(FunctionType::get(Type::getVoidTy(Context), false),
+                         GlobalValue::ExternalLinkage, "f", M.get());
+    MMI.reset(new MachineModuleInfo(*TM->getMCAsmInfo(),
+                                    *TM->getRegisterInfo(), 0));
+    MF.reset(new MachineFunction(F, *TM, 0, *MMI, 0));
+
+    // Three blocks of two instructions each.
+    for (unsigned i = 0; i != 3; ++i) {
+      MachineBasicBlock *MBB = MF->CreateMachineBasicBlock();
+      MF->push_back(MBB);
+      addInstr(MBB);
+      addInstr(MBB);
+    }
+
+    SI.reset(new SlotIndexes());
+    SI->runOnMachineFunction(*MF);
+  }
+
+  virtual void TearDown() {
+    if (SI)
+      SI->releaseMemory();
+  }
+
+  void addInstr(MachineBasicBlock *MBB) {
+    BuildMI(MBB, DebugLoc(),
+            TM->getInstrInfo()->get(TargetOpcode::IMPLICIT_DEF));
+  }
+
+  /// insertBlockAfter - Create an empty block, place it after Pos in the
+  /// function and add it to the slot index maps.
+  MachineBasicBlock *insertBlockAfter(MachineBasicBlock *Pos) {
+    MachineBasicBlock *MBB = MF->CreateMachineBasicBlock();
+    MF->insert(llvm::next(MachineFunction::iterator(Pos)), MBB);
+    SI->insertMBBInMaps(MBB);
+    return MBB;
+  }
+
+  /// expectIndexesIncrease - Check that every index in the list is larger
+  /// than the one before it.
+  void expectIndexesIncrease() {
+    SlotIndex Last = SI->getLastIndex();
+    for (SlotIndex I = SI->getZeroIndex(); I != Last; ) {
+      SlotIndex Next = I.getNextIndex();
+      ASSERT_TRUE(I < Next);
+      I = Next;
+    }
+  }
+
+  /// expectBlockInPlace - Check that MBB is numbered after the block before
+  /// it and up to the start of the block after it.
+  void expectBlockInPlace(MachineBasicBlock *MBB) {
+    MachineFunction::iterator I = MBB;
+    SlotIndex Start = SI->getMBBStartIdx(MBB);
+    EXPECT_TRUE(Start < SI->getMBBEndIdx(MBB));
+    EXPECT_EQ(MBB, SI->getMBBFromIndex(Start));
+    if (I != MF->begin()) {
+      MachineBasicBlock *Prev = prior(I);
+      SlotIndex PrevLast = Prev->empty() ? SI->getMBBStartIdx(Prev) :
+        SI->getInstructionIndex(&Prev->back());
+      EXPECT_TRUE(PrevLast < Start);
+    }
+    if (llvm::next(I) != MF->end())
+      EXPECT_TRUE(SI->getMBBStartIdx(llvm::next(I)) == SI->getMBBEndIdx(MBB));
+  }
+
+  LLVMContext Context;
+  OwningPtr<TargetMachine> TM;
+  OwningPtr<Module> M;
+  Function *F;
+  OwningPtr<MachineModuleInfo> MMI;
+  OwningPtr<MachineFunction> MF;
+  OwningPtr<SlotIndexes> SI;
+};
+
+TEST_F(SlotIndexesTest, InsertBlockBetweenBlocks) {
+  if (!SI)
+    return;
+  MachineBasicBlock *MBB = insertBlockAfter(MF->begin());
+  expectIndexesIncrease();
+  expectBlockInPlace(MBB);
+}
+
+TEST_F(SlotIndexesTest, InsertBlockAtEnd) {
+  if (!SI)
+    return;
+  MachineBasicBlock *MBB = insertBlockAfter(&MF->back());
+  expectIndexesIncrease();
+  expectBlockInPlace(MBB);
+}
+
+TEST_F(SlotIndexesTest, InsertManyBlocksAtOnePoint) {
+  if (!SI)
+    return;
+  // Each block halves the gap left at the insertion point, so this runs out
+  // of room and has to renumber the neighbouring indexes.
+  std::vector<MachineBasicBlock*> Blocks;
+  for (unsigned i = 0; i != 40; ++i)
+    Blocks.push_back(insertBlockAfter(MF->begin()));
+  expectIndexesIncrease();
+  for (unsigned i = 0, e = Blocks.size(); i != e; ++i)
+    expectBlockInPlace(Blocks[i]);
+}
+
+}
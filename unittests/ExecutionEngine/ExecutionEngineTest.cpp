@@ -8,10 +8,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/DerivedTypes.h"
+#include "llvm/Function.h"
 #include "llvm/GlobalVariable.h"
+#include "llvm/IRBuilder.h"
 #include "llvm/LLVMContext.h"
 #include "llvm/Module.h"
 #include "llvm/ADT/OwningPtr.h"
+#include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/Interpreter.h"
 #include "gtest/gtest.h"
 
@@ -128,4 +131,29 @@ TEST_F(ExecutionEngineTest, DestructionRemovesGlobalMapping) {
   EXPECT_EQ(NULL, Engine->getGlobalValueAtAddress(&Mem1));
 }
 
+
+TEST_F(ExecutionEngineTest, UpdatedGlobalMappingIsUsedByLaterRuns) {
+  LLVMContext &Context = getGlobalContext();
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  GlobalVariable *G1 = NewExtGlobal(Int32Ty, "Global1");
+
+  // define i32 @Get() { ret i32 (load @Global1) + 10 }
+  Function *Get = Function::Create(FunctionType::get(Int32Ty, false),
+                                   GlobalValue::ExternalLinkage, "Get", M);
+  IRBuilder<> Builder(BasicBlock::Create(Context, "entry", Get));
+  Builder.CreateRet(Builder.CreateAdd(Builder.CreateLoad(G1),
+                                      ConstantInt::get(Int32Ty, 10)));
+
+  int32_t Mem1 = 3;
+  Engine->addGlobalMapping(G1, &Mem1);
+  std::vector<GenericValue> NoArgs;
+  EXPECT_EQ(13U, Engine->runFunction(Get, NoArgs).IntVal.getZExtValue());
+
+  // The constant operand may be evaluated once, but the address of the
+  // global has to be looked up again.
+  int32_t Mem2 = 4;
+  Engine->updateGlobalMapping(G1, &Mem2);
+  EXPECT_EQ(14U, Engine->runFunction(Get, NoArgs).IntVal.getZExtValue());
+}
+
 }
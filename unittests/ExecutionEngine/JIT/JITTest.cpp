@@ -600,6 +600,85 @@ TEST_F(JITTest, FunctionIsRecompiledAndRelinked) {
   EXPECT_EQ(2, OrigFPtr())
     << "The old pointer's target should now jump to the new version";
 }
+
+TEST_F(JITTest, FunctionIsTieredUp) {
+  Function *F = Function::Create(TypeBuilder<int(int), false>::get(Context),
+                                 GlobalValue::ExternalLinkage, "test", M);
+  BasicBlock *Entry = BasicBlock::Create(Context, "entry", F);
+  IRBuilder<> Builder(Entry);
+  Value *One = ConstantInt::get(TypeBuilder<int, false>::get(Context), 1);
+  Builder.CreateRet(Builder.CreateAdd(F->arg_begin(), One));
+
+  TheJIT->DisableLazyCompilation(true);
+  TheJIT->setTierUpThreshold(3);
+  int (*FPtr)(int) = reinterpret_cast<int(*)(int)>(
+    (intptr_t)TheJIT->getPointerToFunction(F));
+  size_t FirstTierBodies = RJMM->endFunctionBodyCalls.size();
+
+  EXPECT_EQ(2, FPtr(1));
+  EXPECT_EQ(3, FPtr(2));
+  EXPECT_EQ(FirstTierBodies, RJMM->endFunctionBodyCalls.size())
+    << "The function should not be recompiled before the threshold";
+
+  // The third call queues the function; it is still running the first tier.
+  EXPECT_EQ(4, FPtr(3));
+  EXPECT_EQ(FirstTierBodies, RJMM->endFunctionBodyCalls.size())
+    << "The function should not be recompiled while its entry is running";
+
+  // getPointerToFunction is a safe point that recompiles and relinks it.
+  int (*NewFPtr)(int) = reinterpret_cast<int(*)(int)>(
+    (intptr_t)TheJIT->getPointerToFunction(F));
+  EXPECT_EQ(FirstTierBodies + 1, RJMM->endFunctionBodyCalls.size());
+  EXPECT_NE(FPtr, NewFPtr);
+  EXPECT_EQ(5, FPtr(4))
+    << "The old entry point should now jump to the recompiled function";
+  EXPECT_EQ(6, NewFPtr(5));
+  EXPECT_EQ(FirstTierBodies + 1, RJMM->endFunctionBodyCalls.size())
+    << "The recompiled function should not be recompiled again";
+}
+
+TEST_F(JITTest, FunctionIsTieredUpByAnotherFunctionsCallback) {
+  Function *F = Function::Create(TypeBuilder<int(int), false>::get(Context),
+                                 GlobalValue::ExternalLinkage, "hot", M);
+  BasicBlock *Entry = BasicBlock::Create(Context, "entry", F);
+  IRBuilder<> Builder(Entry);
+  Value *One = ConstantInt::get(TypeBuilder<int, false>::get(Context), 1);
+  Builder.CreateRet(Builder.CreateAdd(F->arg_begin(), One));
+
+  Function *G = Function::Create(TypeBuilder<int(void), false>::get(Context),
+                                 GlobalValue::ExternalLinkage, "other", M);
+  Builder.SetInsertPoint(BasicBlock::Create(Context, "entry", G));
+  Builder.CreateRet(One);
+
+  TheJIT->DisableLazyCompilation(true);
+  TheJIT->setTierUpThreshold(2);
+  int (*FPtr)(int) = reinterpret_cast<int(*)(int)>(
+    (intptr_t)TheJIT->getPointerToFunction(F));
+  int (*GPtr)() = reinterpret_cast<int(*)()>(
+    (intptr_t)TheJIT->getPointerToFunction(G));
+  size_t FirstTierBodies = RJMM->endFunctionBodyCalls.size();
+
+  EXPECT_EQ(2, FPtr(1));
+  EXPECT_EQ(3, FPtr(2));
+  EXPECT_EQ(FirstTierBodies, RJMM->endFunctionBodyCalls.size());
+
+  // Entering G is a safe point for F.
+  EXPECT_EQ(1, GPtr());
+  EXPECT_EQ(FirstTierBodies + 1, RJMM->endFunctionBodyCalls.size());
+  EXPECT_EQ(4, FPtr(3));
+
+  // Freeing F drops its tier-up state; compiling it again starts over in the
+  // first tier.
+  TheJIT->freeMachineCodeForFunction(F);
+  FPtr = reinterpret_cast<int(*)(int)>(
+    (intptr_t)TheJIT->getPointerToFunction(F));
+  EXPECT_EQ(FirstTierBodies + 2, RJMM->endFunctionBodyCalls.size());
+  EXPECT_EQ(5, FPtr(4));
+  EXPECT_EQ(6, FPtr(5));
+  EXPECT_EQ(1, GPtr());
+  EXPECT_EQ(FirstTierBodies + 3, RJMM->endFunctionBodyCalls.size())
+    << "The function should be tiered up again after being freed";
+}
 #endif  // !defined(__arm__) && !defined(__powerpc__)
 
 }  // anonymous namespace
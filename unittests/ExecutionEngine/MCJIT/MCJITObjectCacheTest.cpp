@@ -0,0 +1,165 @@
+//===- MCJITObjectCacheTest.cpp - Unit tests for MCJIT object caching -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This test suite verifies that MCJIT hands generated objects to an
+// ObjectCache and loads them back from it instead of compiling again.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "MCJITTestBase.h"
+#include "SectionMemoryManager.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+class TestObjectCache : public ObjectCache {
+public:
+  TestObjectCache() : DuplicateInserted(false) { }
+
+  virtual ~TestObjectCache() {
+    // Free any buffers we've allocated.
+    for (StringMap<MemoryBuffer *>::iterator I = ObjMap.begin(),
+         E = ObjMap.end(); I != E; ++I)
+      delete I->getValue();
+    ObjMap.clear();
+  }
+
+  virtual void notifyObjectCompiled(const Module *M, const MemoryBuffer *Obj) {
+    // If we've seen this module before, note that.
+    const std::string ModuleID = M->getModuleIdentifier();
+    if (ObjMap.find(ModuleID) != ObjMap.end())
+      DuplicateInserted = true;
+    // Store a copy of the buffer in our map.
+    ObjMap[ModuleID] = copyBuffer(Obj);
+  }
+
+  virtual MemoryBuffer *getObject(const Module *M) {
+    const std::string ModuleID = M->getModuleIdentifier();
+    StringMap<MemoryBuffer *>::iterator it = ObjMap.find(ModuleID);
+    if (it == ObjMap.end())
+      return 0;
+    return copyBuffer(it->getValue());
+  }
+
+  bool wereDuplicatesInserted() { return DuplicateInserted; }
+
+  bool isModuleCached(const Module *M) {
+    return ObjMap.find(M->getModuleIdentifier()) != ObjMap.end();
+  }
+
+private:
+  MemoryBuffer *copyBuffer(const MemoryBuffer *Buf) {
+    return MemoryBuffer::getMemBufferCopy(Buf->getBuffer(),
+                                          Buf->getBufferIdentifier());
+  }
+
+  StringMap<MemoryBuffer *> ObjMap;
+  bool DuplicateInserted;
+};
+
+class MCJITObjectCacheTest : public testing::Test, public MCJITTestBase {
+protected:
+
+  enum {
+    OriginalRC = 6,
+    ReplacementRC = 7
+  };
+
+  virtual void SetUp() {
+    M.reset(createEmptyModule("<main>"));
+    Main = insertMainFunction(M.get(), OriginalRC);
+  }
+
+  void compileAndRun(int ExpectedRC = OriginalRC) {
+    // This function shouldn't be called until after SetUp.
+    ASSERT_TRUE(0 != TheJIT.get());
+    ASSERT_TRUE(0 != Main);
+
+    void *vPtr = TheJIT->getPointerToFunction(Main);
+    static_cast<SectionMemoryManager*>(MM)->invalidateInstructionCache();
+    EXPECT_TRUE(0 != vPtr)
+      << "Unable to get pointer to main() from JIT";
+
+    int (*FuncPtr)(void) = (int(*)(void))(intptr_t)vPtr;
+    int returnCode = FuncPtr();
+    EXPECT_EQ(returnCode, ExpectedRC);
+  }
+
+  Function *Main;
+};
+
+TEST_F(MCJITObjectCacheTest, SetNullObjectCache) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  createJIT(M.take());
+
+  TheJIT->setObjectCache(NULL);
+
+  compileAndRun();
+}
+
+TEST_F(MCJITObjectCacheTest, VerifyBasicObjectCaching) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  OwningPtr<TestObjectCache> Cache(new TestObjectCache);
+
+  // Save a copy of the module pointer before handing it off to MCJIT.
+  const Module *SavedModulePointer = M.get();
+
+  createJIT(M.take());
+
+  TheJIT->setObjectCache(Cache.get());
+
+  // Verify that our object cache does not contain the module yet.
+  EXPECT_FALSE(Cache->isModuleCached(SavedModulePointer));
+
+  compileAndRun();
+
+  // Verify that MCJIT handed the compiled object to the cache, exactly once.
+  EXPECT_TRUE(Cache->isModuleCached(SavedModulePointer));
+  EXPECT_FALSE(Cache->wereDuplicatesInserted());
+}
+
+TEST_F(MCJITObjectCacheTest, VerifyLoadFromCache) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  OwningPtr<TestObjectCache> Cache(new TestObjectCache);
+
+  createJIT(M.take());
+
+  TheJIT->setObjectCache(Cache.get());
+
+  // Compile the module and get a pointer to the main function.
+  compileAndRun();
+
+  // Replace the JIT with a new one for a module that returns a different
+  // value but has the same identifier.  If MCJIT loads the cached object
+  // instead of compiling, main still returns the original value.
+  TheJIT.reset();
+  MM = new SectionMemoryManager;
+  M.reset(createEmptyModule("<main>"));
+  Main = insertMainFunction(M.get(), ReplacementRC);
+  createJIT(M.take());
+
+  TheJIT->setObjectCache(Cache.get());
+
+  compileAndRun(OriginalRC);
+
+  // Verify that MCJIT did not try to add this module to the cache again.
+  EXPECT_FALSE(Cache->wereDuplicatesInserted());
+}
+
+} // Namespace
@@ -12,6 +12,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "MCJITTestBase.h"
 #include "SectionMemoryManager.h"
@@ -178,6 +179,79 @@ TEST_F(MCJITTest, multiple_functions) {
     << "Incorrect result returned from function";
 }
 
+TEST_F(MCJITTest, lazy_compilation) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  // 'unreachable' calls a function that cannot be resolved, so compiling the
+  // whole module would fail.  With lazy compilation it is never compiled.
+  Function *Missing = insertExternalReferenceToFunction(M.get(),
+    "mcjit_lazy_missing", TypeBuilder<int32_t(void), false>::get(Context));
+  Function *Unreachable = startFunction<int32_t(void)>(M.get(), "unreachable");
+  endFunctionWithRet(Unreachable, Builder.CreateCall(Missing));
+
+  Function *Add = insertAddFunction(M.get());
+  Function *Caller = insertSimpleCallFunction<int32_t(int32_t, int32_t)>(
+    M.get(), Add);
+
+  // 'twice' is compiled in a second unit that links against 'add'.
+  Function *Twice = startFunction<int32_t(int32_t)>(M.get(), "twice");
+  Value *Arg = Twice->arg_begin();
+  endFunctionWithRet(Twice, Builder.CreateCall2(Add, Arg, Arg));
+
+  createJIT(M.take());
+  TheJIT->DisableLazyCompilation(false);
+  TheJIT->EnableUnitCompilation();
+
+  void *CallerPtr = TheJIT->getPointerToFunction(Caller);
+  void *TwicePtr = TheJIT->getPointerToFunction(Twice);
+  static_cast<SectionMemoryManager*>(MM)->invalidateInstructionCache();
+  EXPECT_TRUE(0 != CallerPtr)
+    << "Unable to get pointer to caller function from JIT";
+  EXPECT_TRUE(0 != TwicePtr)
+    << "Unable to get pointer to twice function from JIT";
+
+  int32_t(*CallerFn)(int32_t, int32_t) =
+    (int32_t(*)(int32_t, int32_t))(intptr_t)CallerPtr;
+  EXPECT_EQ(30, CallerFn(10, 20));
+
+  int32_t(*TwiceFn)(int32_t) = (int32_t(*)(int32_t))(intptr_t)TwicePtr;
+  EXPECT_EQ(42, TwiceFn(21));
+}
+
+/// ObjectCounter - Counts the objects an engine loads.
+class ObjectCounter : public JITEventListener {
+public:
+  unsigned NumObjects;
+  ObjectCounter() : NumObjects(0) {}
+  virtual void NotifyObjectEmitted(const ObjectImage &Obj) { ++NumObjects; }
+};
+
+TEST_F(MCJITTest, lazy_finalize_without_units) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  // Without unit compilation, lazy mode still compiles the whole module, so
+  // finalizeObject has to emit it.
+  Function *Add = insertAddFunction(M.get());
+  createJIT(M.take());
+  TheJIT->DisableLazyCompilation(false);
+
+  ObjectCounter Counter;
+  TheJIT->RegisterJITEventListener(&Counter);
+  TheJIT->finalizeObject();
+  EXPECT_EQ(1U, Counter.NumObjects)
+    << "finalizeObject did not compile the module";
+
+  void *vPtr = TheJIT->getPointerToFunction(Add);
+  static_cast<SectionMemoryManager*>(MM)->invalidateInstructionCache();
+  EXPECT_EQ(1U, Counter.NumObjects)
+    << "The module was compiled more than once";
+  TheJIT->UnregisterJITEventListener(&Counter);
+
+  int32_t(*AddPtr)(int32_t, int32_t) =
+    (int32_t(*)(int32_t, int32_t))(intptr_t)vPtr;
+  EXPECT_EQ(3, AddPtr(1, 2));
+}
+
 // FIXME: ExecutionEngine has no support empty modules
 /*
 TEST_F(MCJITTest, multiple_empty_modules) {
@@ -0,0 +1,254 @@
+//===- llvm/unittest/LTO/LTOCodeGeneratorTest.cpp - libLTO tests ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm-c/lto.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Function.h"
+#include "llvm/IRBuilder.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include "gtest/gtest.h"
+#include <string>
+
+using namespace llvm;
+using namespace object;
+
+namespace {
+
+class LTOCodeGeneratorTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    LLVMContext Context;
+    Module M("lto-test", Context);
+    Function *F = Function::Create(FunctionType::get(Type::getInt32Ty(Context),
+                                                     false),
+                                   GlobalValue::ExternalLinkage, "answer", &M);
+    IRBuilder<> Builder(BasicBlock::Create(Context, "entry", F));
+    Builder.CreateRet(Builder.getInt32(42));
+
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS);
+    OS.flush();
+
+    std::string ErrMsg;
+    TempDir = sys::Path::GetTemporaryDirectory(&ErrMsg);
+    ASSERT_TRUE(ErrMsg.empty()) << ErrMsg;
+    SmallString<128> Cache(TempDir.str());
+    sys::path::append(Cache, "cache");
+    CacheDir = Cache.str();
+  }
+
+  virtual void TearDown() {
+    TempDir.eraseFromDisk(true);
+  }
+
+  /// compile - Run the LTO code generator on the test module, with the cache
+  /// directory set if UseCache, and return the object it produced.
+  std::string compile(bool UseCache) {
+    lto_module_t Mod = lto_module_create_from_memory(Bitcode.data(),
+                                                     Bitcode.size());
+    EXPECT_TRUE(Mod != 0) << lto_get_error_message();
+    if (!Mod)
+      return std::string();
+
+    lto_code_gen_t CG = lto_codegen_create();
+    lto_codegen_add_module(CG, Mod);
+    lto_codegen_add_must_preserve_symbol(CG, "answer");
+    if (UseCache)
+      lto_codegen_set_cache_dir(CG, CacheDir.c_str());
+
+    size_t Length = 0;
+    const void *Obj = lto_codegen_compile(CG, &Length);
+    EXPECT_TRUE(Obj != 0) << lto_get_error_message();
+    std::string Result;
+    if (Obj)
+      Result.assign(static_cast<const char*>(Obj), Length);
+
+    lto_codegen_dispose(CG);
+    lto_module_dispose(Mod);
+    return Result;
+  }
+
+  /// getCacheEntries - Return the paths of the files in the cache directory.
+  std::vector<std::string> getCacheEntries() {
+    std::vector<std::string> Entries;
+    error_code EC;
+    for (sys::fs::directory_iterator I(CacheDir, EC), E; I != E && !EC;
+         I.increment(EC))
+      Entries.push_back(I->path());
+    return Entries;
+  }
+
+  /// compileToFiles - Run the LTO code generator on the module in BC, split
+  /// into NumPartitions partitions, and return the contents of the objects.
+  std::vector<std::string> compileToFiles(StringRef BC,
+                                          unsigned NumPartitions) {
+    std::vector<std::string> Objects;
+    lto_module_t Mod = lto_module_create_from_memory(BC.data(), BC.size());
+    EXPECT_TRUE(Mod != 0) << lto_get_error_message();
+    if (!Mod)
+      return Objects;
+
+    lto_code_gen_t CG = lto_codegen_create();
+    lto_codegen_add_module(CG, Mod);
+    for (unsigned i = 0; i != NumExported; ++i)
+      lto_codegen_add_must_preserve_symbol(CG, getExportedName(i).c_str());
+    lto_codegen_set_num_partitions(CG, NumPartitions);
+
+    const char **Names = 0;
+    unsigned NumNames = 0;
+    bool Failed = lto_codegen_compile_to_files(CG, &Names, &NumNames);
+    EXPECT_FALSE(Failed) << lto_get_error_message();
+    for (unsigned i = 0; !Failed && i != NumNames; ++i) {
+      OwningPtr<MemoryBuffer> Buffer;
+      EXPECT_FALSE(MemoryBuffer::getFile(Names[i], Buffer));
+      if (Buffer)
+        Objects.push_back(Buffer->getBuffer());
+      sys::Path(Names[i]).eraseFromDisk();
+    }
+
+    lto_codegen_dispose(CG);
+    lto_module_dispose(Mod);
+    return Objects;
+  }
+
+  static const unsigned NumExported = 6;
+
+  static std::string getExportedName(unsigned i) {
+    return "exported" + std::string(1, '0' + i);
+  }
+
+  /// writePartitionedModule - Write a module with some exported functions to
+  /// BC.  Each calls a helper of its own and a helper they all share.
+  static void writePartitionedModule(SmallVectorImpl<char> &BC) {
+    LLVMContext Context;
+    Module M("lto-partition-test", Context);
+    Type *Int32Ty = Type::getInt32Ty(Context);
+    FunctionType *FTy = FunctionType::get(Int32Ty, false);
+    GlobalVariable *Counter =
+      new GlobalVariable(M, Int32Ty, false, GlobalValue::InternalLinkage,
+                         ConstantInt::get(Int32Ty, 0), "counter");
+
+    Function *Shared = Function::Create(FTy, GlobalValue::InternalLinkage,
+                                        "shared", &M);
+    Shared->addFnAttr(Attributes::NoInline);
+    IRBuilder<> Builder(BasicBlock::Create(Context, "entry", Shared));
+    Value *Next = Builder.CreateAdd(Builder.CreateLoad(Counter),
+                                    Builder.getInt32(1));
+    Builder.CreateStore(Next, Counter);
+    Builder.CreateRet(Next);
+
+    for (unsigned i = 0; i != NumExported; ++i) {
+      Function *Own = Function::Create(FTy, GlobalValue::InternalLinkage,
+                                       "own", &M);
+      Own->addFnAttr(Attributes::NoInline);
+      Builder.SetInsertPoint(BasicBlock::Create(Context, "entry", Own));
+      Builder.CreateRet(Builder.CreateMul(Builder.CreateLoad(Counter),
+                                          Builder.getInt32(i + 2)));
+
+      Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                     getExportedName(i), &M);
+      Builder.SetInsertPoint(BasicBlock::Create(Context, "entry", F));
+      Builder.CreateRet(Builder.CreateAdd(Builder.CreateCall(Shared),
+                                          Builder.CreateCall(Own)));
+    }
+
+    raw_svector_ostream OS(BC);
+    WriteBitcodeToFile(&M, OS);
+    OS.flush();
+  }
+
+  SmallString<1024> Bitcode;
+  sys::Path TempDir;
+  std::string CacheDir;
+};
+
+TEST_F(LTOCodeGeneratorTest, CacheDir) {
+  // lto_codegen_set_cache_dir was added in version 5 of the API.
+  EXPECT_LE(5, LTO_API_VERSION);
+
+  std::string Obj = compile(true);
+  ASSERT_FALSE(Obj.empty());
+  std::vector<std::string> Entries = getCacheEntries();
+  ASSERT_EQ(1U, Entries.size());
+
+  // Replace the cached object.  The next link of the same module has to
+  // return the replacement instead of generating code.
+  {
+    std::string ErrorInfo;
+    raw_fd_ostream OS(Entries[0].c_str(), ErrorInfo, raw_fd_ostream::F_Binary);
+    ASSERT_TRUE(ErrorInfo.empty()) << ErrorInfo;
+    OS << "cached";
+  }
+  EXPECT_EQ("cached", compile(true));
+
+  // Without a cache directory the object is generated again.
+  EXPECT_EQ(Obj, compile(false));
+}
+
+TEST_F(LTOCodeGeneratorTest, Partitions) {
+  // lto_codegen_compile_to_files was added in version 6 of the API.
+  EXPECT_LE(6, LTO_API_VERSION);
+
+  SmallString<4096> BC;
+  writePartitionedModule(BC);
+  std::vector<std::string> Objects = compileToFiles(BC, 3);
+  ASSERT_LE(2U, Objects.size());
+  ASSERT_GE(3U, Objects.size());
+
+  // Every symbol is defined by exactly one partition, and every symbol a
+  // partition refers to is defined by another one.
+  StringMap<unsigned> Defined;
+  std::vector<std::string> Undefined;
+  for (unsigned i = 0, e = Objects.size(); i != e; ++i) {
+    OwningPtr<ObjectFile> Obj(ObjectFile::createObjectFile(
+      MemoryBuffer::getMemBuffer(Objects[i], "", false)));
+    ASSERT_TRUE(Obj != 0);
+    error_code EC;
+    for (symbol_iterator I = Obj->begin_symbols(), E = Obj->end_symbols();
+         I != E && !EC; I.increment(EC)) {
+      uint32_t Flags;
+      StringRef Name;
+      ASSERT_FALSE(I->getFlags(Flags));
+      ASSERT_FALSE(I->getName(Name));
+      if (!(Flags & SymbolRef::SF_Global))
+        continue;
+      if (Flags & SymbolRef::SF_Undefined)
+        Undefined.push_back(Name);
+      else
+        ++Defined[Name];
+    }
+  }
+  for (unsigned i = 0; i != NumExported; ++i)
+    EXPECT_EQ(1U, Defined.lookup(getExportedName(i))) << getExportedName(i);
+  for (StringMap<unsigned>::iterator I = Defined.begin(), E = Defined.end();
+       I != E; ++I)
+    EXPECT_EQ(1U, I->getValue()) << I->getKey().str();
+  EXPECT_FALSE(Undefined.empty());
+  for (unsigned i = 0, e = Undefined.size(); i != e; ++i)
+    EXPECT_EQ(1U, Defined.lookup(Undefined[i])) << Undefined[i];
+
+  // The output does not depend on how the partitions were scheduled.
+  EXPECT_TRUE(Objects == compileToFiles(BC, 3));
+
+  // One partition gives one object.
+  EXPECT_EQ(1U, compileToFiles(BC, 1).size());
+}
+
+}
@@ -36,6 +36,9 @@ struct InstructionMemo {
   const CodeGenRegisterClass *RC;
   std::string SubRegNo;
   std::vector<std::string>* PhysRegs;
+  // If non-null, the instruction's first source operand is an undefined
+  // register of this class, materialized with an IMPLICIT_DEF.
+  const CodeGenRegisterClass *ImpDefRC;
 };
 } // End anonymous namespace
 
@@ -381,6 +384,9 @@ public:
   void collectPatterns(CodeGenDAGPatterns &CGP);
   void printImmediatePredicates(raw_ostream &OS);
   void printFunctionDefinitions(raw_ostream &OS);
+private:
+  void printFastEmitInst(raw_ostream &OS, const OperandsSignature &Operands,
+                         const InstructionMemo &Memo, bool HasPred);
 };
 } // End anonymous namespace
 
@@ -440,13 +446,21 @@ void FastISelMap::collectPatterns(CodeGenDAGPatterns &CGP) {
     if (II.Operands.empty())
       continue;
 
-    // For now, ignore multi-instruction patterns.
+    // The only multi-instruction patterns handled are those whose first
+    // operand is an (IMPLICIT_DEF), as used for the pass-through operand of
+    // scalar AVX instructions.  Ignore everything else.
     bool MultiInsts = false;
+    bool LeadingImpDef = false;
     for (unsigned i = 0, e = Dst->getNumChildren(); i != e; ++i) {
       TreePatternNode *ChildOp = Dst->getChild(i);
       if (ChildOp->isLeaf())
         continue;
       if (ChildOp->getOperator()->isSubClassOf("Instruction")) {
+        if (i == 0 && ChildOp->getNumChildren() == 0 &&
+            ChildOp->getOperator()->getName() == "IMPLICIT_DEF") {
+          LeadingImpDef = true;
+          continue;
+        }
         MultiInsts = true;
         break;
       }
@@ -467,6 +481,8 @@ void FastISelMap::collectPatterns(CodeGenDAGPatterns &CGP) {
       DstRC = &Target.getRegisterClass(Op0Rec);
       if (!DstRC)
         continue;
+    } else if (LeadingImpDef) {
+      continue;
     } else {
       // If this isn't a leaf, then continue since the register classes are
       // a bit too complicated for now.
@@ -506,6 +522,20 @@ void FastISelMap::collectPatterns(CodeGenDAGPatterns &CGP) {
     if (!Operands.initialize(InstPatNode, Target, VT, ImmediatePredicates))
       continue;
 
+    // The undefined operand needs a register class to create its vreg in.
+    const CodeGenRegisterClass *ImpDefRC = 0;
+    if (LeadingImpDef) {
+      unsigned OpNo = II.Operands.NumDefs;
+      if (OpNo >= II.Operands.size())
+        continue;
+      Record *OpRec = II.Operands[OpNo].Rec;
+      if (OpRec->isSubClassOf("RegisterOperand"))
+        OpRec = OpRec->getValueAsDef("RegClass");
+      if (!OpRec->isSubClassOf("RegisterClass"))
+        continue;
+      ImpDefRC = &Target.getRegisterClass(OpRec);
+    }
+
     std::vector<std::string>* PhysRegInputs = new std::vector<std::string>();
     if (InstPatNode->getOperator()->getName() == "imm" ||
         InstPatNode->getOperator()->getName() == "fpimm")
@@ -514,7 +544,7 @@ void FastISelMap::collectPatterns(CodeGenDAGPatterns &CGP) {
       // Compute the PhysRegs used by the given pattern, and check that
       // the mapping from the src to dst patterns is simple.
       bool FoundNonSimplePattern = false;
-      unsigned DstIndex = 0;
+      unsigned DstIndex = LeadingImpDef ? 1 : 0;
       for (unsigned i = 0, e = InstPatNode->getNumChildren(); i != e; ++i) {
         std::string PhysReg = PhyRegForNode(InstPatNode->getChild(i), Target);
         if (PhysReg.empty()) {
@@ -533,8 +563,23 @@ void FastISelMap::collectPatterns(CodeGenDAGPatterns &CGP) {
       if (Op->getName() != "EXTRACT_SUBREG" && DstIndex < Dst->getNumChildren())
         FoundNonSimplePattern = true;
 
-      if (FoundNonSimplePattern)
+      // FastISel only has emitters for a fixed set of operand lists; make
+      // sure one exists once the undefined register operand is added.
+      if (!FoundNonSimplePattern && LeadingImpDef) {
+        std::string Suffix = "r";
+        raw_string_ostream SS(Suffix);
+        Operands.PrintManglingSuffix(SS, *PhysRegInputs, ImmediatePredicates,
+                                     true);
+        SS.flush();
+        if (Suffix != "r" && Suffix != "rr" && Suffix != "rrr" &&
+            Suffix != "ri" && Suffix != "rri" && Suffix != "rf")
+          FoundNonSimplePattern = true;
+      }
+
+      if (FoundNonSimplePattern) {
+        delete PhysRegInputs;
         continue;
+      }
     }
 
     // Get the predicate that guards this pattern.
@@ -545,7 +590,8 @@ void FastISelMap::collectPatterns(CodeGenDAGPatterns &CGP) {
       Pattern.getDstPattern()->getOperator()->getName(),
       DstRC,
       SubRegNo,
-      PhysRegInputs
+      PhysRegInputs,
+      ImpDefRC
     };
     
     if (SimplePatterns[Operands][OpcodeName][VT][RetVT].count(PredicateCheck))
@@ -579,6 +625,34 @@ void FastISelMap::printImmediatePredicates(raw_ostream &OS) {
 }
 
 
+/// printFastEmitInst - Emit the statement that builds the instruction
+/// described by Memo and returns its result register.  HasPred is set when
+/// the statement is nested in a predicate check.
+void FastISelMap::printFastEmitInst(raw_ostream &OS,
+                                    const OperandsSignature &Operands,
+                                    const InstructionMemo &Memo,
+                                    bool HasPred) {
+  if (Memo.ImpDefRC) {
+    OS << "  unsigned ImpDef = FastEmitInst_(TargetOpcode::IMPLICIT_DEF, &"
+       << InstNS << Memo.ImpDefRC->getName() << "RegClass);\n";
+    if (HasPred)
+      OS << "  ";
+  }
+
+  OS << "  return FastEmitInst_";
+  if (Memo.ImpDefRC)
+    OS << 'r';
+  Operands.PrintManglingSuffix(OS, *Memo.PhysRegs, ImmediatePredicates, true);
+  OS << "(" << InstNS << Memo.Name << ", ";
+  OS << "&" << InstNS << Memo.RC->getName() << "RegClass";
+  if (Memo.ImpDefRC)
+    OS << ", ImpDef, true";
+  if (!Operands.empty())
+    OS << ", ";
+  Operands.PrintArguments(OS, *Memo.PhysRegs);
+  OS << ");\n";
+}
+
 void FastISelMap::printFunctionDefinitions(raw_ostream &OS) {
   // Now emit code for all the patterns that we collected.
   for (OperandsOpcodeTypeRetPredMap::const_iterator OI = SimplePatterns.begin(),
@@ -639,18 +713,10 @@ void FastISelMap::printFunctionDefinitions(raw_ostream &OS) {
                      << (*Memo.PhysRegs)[i] << ").addReg(Op" << i << ");\n";
               }
 
-              OS << "  return FastEmitInst_";
               if (Memo.SubRegNo.empty()) {
-                Operands.PrintManglingSuffix(OS, *Memo.PhysRegs,
-                                             ImmediatePredicates, true);
-                OS << "(" << InstNS << Memo.Name << ", ";
-                OS << "&" << InstNS << Memo.RC->getName() << "RegClass";
-                if (!Operands.empty())
-                  OS << ", ";
-                Operands.PrintArguments(OS, *Memo.PhysRegs);
-                OS << ");\n";
+                printFastEmitInst(OS, Operands, Memo, HasPred);
               } else {
-                OS << "extractsubreg(" << getName(RetVT);
+                OS << "  return FastEmitInst_extractsubreg(" << getName(RetVT);
                 OS << ", Op0, Op0IsKill, " << Memo.SubRegNo << ");\n";
               }
 
@@ -730,21 +796,12 @@ void FastISelMap::printFunctionDefinitions(raw_ostream &OS) {
                    << (*Memo.PhysRegs)[i] << ").addReg(Op" << i << ");\n";
             }
 
-            OS << "  return FastEmitInst_";
-
             if (Memo.SubRegNo.empty()) {
-              Operands.PrintManglingSuffix(OS, *Memo.PhysRegs,
-                                           ImmediatePredicates, true);
-              OS << "(" << InstNS << Memo.Name << ", ";
-              OS << "&" << InstNS << Memo.RC->getName() << "RegClass";
-              if (!Operands.empty())
-                OS << ", ";
-              Operands.PrintArguments(OS, *Memo.PhysRegs);
-              OS << ");\n";
+              printFastEmitInst(OS, Operands, Memo, HasPred);
             } else {
-              OS << "extractsubreg(RetVT, Op0, Op0IsKill, ";
-              OS << Memo.SubRegNo;
-              OS << ");\n";
+              OS << "  return FastEmitInst_extractsubreg(RetVT, Op0, "
+                 << "Op0IsKill, "
+                 << Memo.SubRegNo << ");\n";
             }
 
              if (HasPred)